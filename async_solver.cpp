@@ -0,0 +1,68 @@
+#include "async_solver.h"
+
+AsyncSolver::AsyncSolver(SolverTables* solverTables) : tables(solverTables), quit(false), queued(false), running(false), preloading(false), runningJob(0), maxLength(22), timeBudget(0.0),
+    job(0), fresh(false), abort(false) {
+    worker = std::thread(&AsyncSolver::run, this);
+}
+
+AsyncSolver::~AsyncSolver() {
+    { std::lock_guard<std::mutex> lock(mutex); quit = true; abort.store(true); }
+    wake.notify_one();
+    worker.join();
+}
+
+void AsyncSolver::preload() {
+    { std::lock_guard<std::mutex> lock(mutex); preloading = true; }
+    wake.notify_one();
+}
+
+void AsyncSolver::start(const CubeState& s, int length, double budget) {
+    { std::lock_guard<std::mutex> lock(mutex); state = s; maxLength = length; timeBudget = budget; job++; queued = true; fresh = false; abort.store(true); }
+    wake.notify_one();
+}
+
+void AsyncSolver::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    job++; queued = false; fresh = false; abort.store(true);
+}
+
+bool AsyncSolver::searching() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queued || (running && runningJob == job);
+}
+
+bool AsyncSolver::poll(std::vector<MoveType>& solution) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fresh) return false;
+    solution = latest; fresh = false;
+    return true;
+}
+
+// running covers the job taken from the queue until its solve() returns, cancelled or not, so a
+// cancelled search never overlaps the next one; searching() only counts it while it is still current
+void AsyncSolver::run() {
+    std::unique_ptr<Solver> solver;
+    std::vector<MoveType> out;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return quit || queued || preloading; });
+        if (quit) return;
+        if (preloading) {
+            preloading = false;
+            lock.unlock();
+            (tables ? *tables : solverTables()).ensureCornerPrune();
+            lock.lock();
+            continue;
+        }
+        CubeState s = state; int length = maxLength; double budget = timeBudget; uint64_t id = job;
+        queued = false; running = true; runningJob = id; abort.store(false);
+        lock.unlock();
+        if (!solver) { solver.reset(new Solver(tables ? *tables : solverTables())); solver->setCancel(&abort); }
+        solver->solve(s, out, length, budget, [&](const std::vector<MoveType>& found) {
+            std::lock_guard<std::mutex> report(mutex);
+            if (id == job) { latest = found; fresh = true; }
+        });
+        lock.lock();
+        running = false;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+// One solve at a time in the background, for callers with a frame to draw. start() returns at once;
+// the job reports each shorter solution as it finds it (the two-phase one first, then better ones
+// while its time budget lasts) and poll() hands over the newest. cancel(), or starting another job,
+// abandons it: its later results are dropped and its search stops within a few thousand nodes.
+#include "solver.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class AsyncSolver {
+public:
+    // nullptr for solverTables(); either way the tables are first touched on the worker, so loading
+    // or building them never stalls the caller
+    explicit AsyncSolver(SolverTables* tables = nullptr);
+    ~AsyncSolver();
+
+    // Touches the tables and builds or verifies the optimal-search one on the worker now, ahead of the
+    // first job with a time budget; a job started meanwhile waits for it
+    void preload();
+    // As Solver::solve(state, ..., maxLength, timeBudget), replacing any job still queued or running
+    void start(const CubeState& state, int maxLength = 22, double timeBudget = 0.0);
+    void cancel();
+    // True from start() until the job has finished or been cancelled; results it reports before
+    // finishing are ready for poll() once this is false
+    bool searching() const;
+    // The current job's newest solution, if there is one poll() has not handed over yet
+    bool poll(std::vector<MoveType>& solution);
+
+private:
+    SolverTables* tables;
+    std::thread worker;
+    mutable std::mutex mutex; std::condition_variable wake; // guard everything below but abort
+    bool quit, queued, running, preloading; uint64_t runningJob; // the job of the search running, current or not
+    CubeState state; int maxLength; double timeBudget;
+    uint64_t job; // bumped by start() and cancel(); results of any other job are dropped
+    std::vector<MoveType> latest; bool fresh;
+    std::atomic<bool> abort; // the running search's cancel flag
+
+    void run();
+};
@@ -0,0 +1,46 @@
+#include "batch_solver.h"
+
+#include <algorithm>
+
+namespace {
+const size_t BATCH_GRAIN = 4; // solves vary from microseconds to tens of milliseconds, so keep chunks small to steal
+}
+
+void BatchSolutions::copy(size_t i, std::vector<MoveType>& out) const {
+    out.clear();
+    for (int k = 0; k < length(i); k++) out.push_back(move(i, k));
+}
+
+BatchSolver::BatchSolver(SolverTables& tables, ThreadPool& threadPool) : pool(threadPool) {
+    for (int i = 0; i < pool.size(); i++) workers.emplace_back(new Worker(tables));
+}
+
+void BatchSolver::prepare(size_t count, BatchSolutions& out) {
+    out.moves.resize(count * BatchSolutions::MAX_MOVES);
+    out.lengths.assign(count, -1);
+}
+
+void BatchSolver::solveOne(int worker, const CubeState& state, size_t i, BatchSolutions& out, int maxLength, double timeBudget) {
+    Worker& w = *workers[worker];
+    if (!w.solver.solve(state, w.scratch, maxLength, timeBudget) || (int)w.scratch.size() > BatchSolutions::MAX_MOVES) return;
+    std::copy(w.scratch.begin(), w.scratch.end(), out.moves.begin() + i * BatchSolutions::MAX_MOVES);
+    out.lengths[i] = (int8_t)w.scratch.size();
+}
+
+void BatchSolver::solve(const CubeState* states, size_t count, BatchSolutions& out, int maxLength, double timeBudget) {
+    prepare(count, out);
+    pool.parallelFor(count, BATCH_GRAIN, [&](size_t begin, size_t end, int worker) {
+        for (size_t i = begin; i < end; i++) solveOne(worker, states[i], i, out, maxLength, timeBudget);
+    });
+}
+
+void BatchSolver::solveSequences(const std::vector<std::vector<MoveType>>& sequences, BatchSolutions& out, int maxLength, double timeBudget) {
+    prepare(sequences.size(), out);
+    pool.parallelFor(sequences.size(), BATCH_GRAIN, [&](size_t begin, size_t end, int worker) {
+        for (size_t i = begin; i < end; i++) {
+            CubeState s;
+            s.apply(sequences[i].data(), (int)sequences[i].size());
+            solveOne(worker, s, i, out, maxLength, timeBudget);
+        }
+    });
+}
@@ -0,0 +1,49 @@
+#pragma once
+// Headless throughput entry point: solves many cubes in parallel on a thread pool.
+#include "solver.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Solutions of one batch stored back to back in fixed-size slots, so workers fill them without allocating
+struct BatchSolutions {
+    static const int MAX_MOVES = 32; // the two-phase search needs at most 22 face turns plus a few slice turns
+
+    std::vector<uint8_t> moves;   // slot i is moves[i * MAX_MOVES ...]
+    std::vector<int8_t> lengths;  // -1 for states that are invalid or have no solution within maxLength
+
+    size_t size() const { return lengths.size(); }
+    bool solved(size_t i) const { return lengths[i] >= 0; }
+    int length(size_t i) const { return lengths[i] < 0 ? 0 : lengths[i]; }
+    MoveType move(size_t i, int k) const { return static_cast<MoveType>(moves[i * MAX_MOVES + k]); }
+    void copy(size_t i, std::vector<MoveType>& out) const;
+};
+
+class BatchSolver {
+public:
+    // The tables are shared read-only by every worker; each worker keeps its own Solver and scratch.
+    // Optimal searches (timeBudget > 0, seconds per state, as in Solver::solve) all share
+    // sharedTranspositionTable(). One batch at a time per BatchSolver; use one instance per calling thread.
+    explicit BatchSolver(SolverTables& tables = solverTables(), ThreadPool& pool = sharedThreadPool());
+
+    void solve(const CubeState* states, size_t count, BatchSolutions& out, int maxLength = 22, double timeBudget = 0.0);
+    void solve(const std::vector<CubeState>& states, BatchSolutions& out, int maxLength = 22, double timeBudget = 0.0) { solve(states.data(), states.size(), out, maxLength, timeBudget); }
+    // Each sequence is applied to a solved cube, and the result solved
+    void solveSequences(const std::vector<std::vector<MoveType>>& sequences, BatchSolutions& out, int maxLength = 22, double timeBudget = 0.0);
+
+private:
+    struct alignas(64) Worker {
+        Solver solver;
+        std::vector<MoveType> scratch;
+        explicit Worker(SolverTables& t) : solver(t) { scratch.reserve(BatchSolutions::MAX_MOVES); }
+    };
+
+    ThreadPool& pool;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    void prepare(size_t count, BatchSolutions& out);
+    void solveOne(int worker, const CubeState& state, size_t i, BatchSolutions& out, int maxLength, double timeBudget);
+};
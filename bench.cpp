@@ -0,0 +1,137 @@
+// Headless benchmarks for librubik: move application, solve latency, batch throughput and optimal solves.
+// Scrambles come from fixed seeds so runs are comparable across commits.
+#include "batch_solver.h"
+#include "bench_report.h"
+#include "cube_batch.h"
+#include "cube_state.h"
+#include "scramble.h"
+#include "solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds(Clock::time_point since) { return std::chrono::duration<double>(Clock::now() - since).count(); }
+
+void seededScramble(unsigned seed, int length, std::vector<MoveType>& out) {
+    Xoshiro256 rng(seed);
+    randomMoveScramble(rng, length, out);
+}
+
+void benchMoves(BenchReport& report) {
+    const int N = 4000000;
+    std::vector<MoveType> moves; seededScramble(1, 4096, moves);
+    CubeState s;
+    Clock::time_point t = Clock::now();
+    for (int i = 0; i < N; i++) s.apply(moves[i & 4095]);
+    double dt = seconds(t);
+    volatile uint8_t sink = s.cp[0]; (void)sink; // keep the loop from being optimized away
+    report.add("state_apply", "moves_per_sec", N / dt, "1/s");
+
+    // The same 4096 moves on a batch of 4096 cubes: as one sequence, then move by move
+    CubeBatch batch(4096);
+    t = Clock::now();
+    batch.apply(moves);
+    dt = seconds(t);
+    report.add("cube_batch_sequence", "moves_per_sec", 4096.0 * moves.size() / dt, "1/s");
+    t = Clock::now();
+    for (int i = 0; i < 256; i++) batch.apply(moves[i]);
+    dt = seconds(t);
+    report.add("cube_batch_move", "moves_per_sec", 4096.0 * 256 / dt, "1/s");
+    const char* isa = CubeBatch::instructionSet();
+    report.add("cube_batch", "vector_bytes", !std::strcmp(isa, "avx2") ? 32 : !std::strcmp(isa, "scalar") ? 1 : 16, "bytes");
+    sink = (uint8_t)batch.isSolved(0); // keep the batch live too
+}
+
+void benchSolve(BenchReport& report, int count) {
+    Clock::time_point t = Clock::now();
+    solverTables();
+    report.add("solver_tables", "load", seconds(t) * 1e3, "ms");
+
+    Solver solver;
+    std::vector<MoveType> scramble, solution;
+    std::vector<double> latency, length;
+    for (int i = 0; i < count; i++) {
+        seededScramble(1000 + i, 25, scramble);
+        CubeState s; s.apply(scramble.data(), (int)scramble.size());
+        t = Clock::now();
+        if (!solver.solve(s, solution)) { std::cerr << "bench: scramble " << i << " did not solve" << std::endl; continue; }
+        latency.push_back(seconds(t) * 1e3);
+        length.push_back((double)solver.faceMoves().size());
+    }
+    report.addDistribution("solve_latency", latency, "ms");
+    report.addDistribution("solve_length", length, "face_turns");
+}
+
+void benchBatch(BenchReport& report, int count) {
+    std::vector<std::vector<MoveType>> scrambles(count);
+    for (int i = 0; i < count; i++) seededScramble(5000 + i, 25, scrambles[i]);
+    BatchSolver solver;
+    BatchSolutions solutions;
+    Clock::time_point t = Clock::now();
+    solver.solveSequences(scrambles, solutions);
+    double dt = seconds(t);
+    report.add("batch_solve", "solves_per_sec", count / dt, "1/s");
+    report.add("batch_solve", "threads", sharedThreadPool().size(), "count");
+}
+
+// Bulk scramble generation: random-move ones are pure generator work, random-state ones a solve each
+void benchScramble(BenchReport& report, int states) {
+    const size_t MOVE_SCRAMBLES = 1 << 22;
+    ScrambleGenerator generator;
+    BatchSolutions out;
+    Clock::time_point t = Clock::now();
+    generator.generate(1, 0, MOVE_SCRAMBLES, SCRAMBLE_RANDOM_MOVES, out);
+    report.add("scramble_random_moves", "scrambles_per_sec", MOVE_SCRAMBLES / seconds(t), "1/s");
+    t = Clock::now();
+    generator.generate(1, 0, states, SCRAMBLE_RANDOM_STATE, out);
+    report.add("scramble_random_state", "scrambles_per_sec", states / seconds(t), "1/s");
+}
+
+// Optimal solves of 12-turn scrambles, then of a symmetric conjugate of each: the second pass finds
+// the first one's classes in the transposition table
+void benchOptimal(BenchReport& report, int count) {
+    Clock::time_point t = Clock::now();
+    solverTables().ensureCornerPrune();
+    report.add("corner_tables", "load", seconds(t) * 1e3, "ms");
+    report.add("corner_tables", "size", SolverTables::tableSize(CORNER_PRUNE) / 1048576.0, "MB");
+
+    Solver solver;
+    std::vector<MoveType> scramble, solution;
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<double> latency;
+        for (int i = 0; i < count; i++) {
+            Xoshiro256 rng(9000 + i); randomMoveScramble(rng, 12, scramble); // face turns: slices would double the length
+            CubeState s; s.apply(scramble.data(), (int)scramble.size());
+            if (pass) s = conjugate(s, 1 + i % (N_SYM - 1));
+            t = Clock::now();
+            if (!solver.solve(s, solution, 22, 60.0)) { std::cerr << "bench: optimal scramble " << i << " did not solve" << std::endl; continue; }
+            latency.push_back(seconds(t) * 1e3);
+        }
+        report.addDistribution(pass ? "optimal_symmetric_latency" : "optimal_latency", latency, "ms");
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report;
+    report.parseArgs(argc, argv);
+    int solves = 200;
+    for (int i = 1; i + 1 < argc; i++) if (std::strcmp(argv[i], "--solves") == 0) solves = std::atoi(argv[i + 1]);
+
+    benchMoves(report);
+    benchSolve(report, solves);
+    benchBatch(report, solves * 2);
+    benchScramble(report, solves * 2);
+    benchOptimal(report, std::max(1, solves / 10));
+    report.write(std::cout);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+// Benchmark results as JSON Lines or CSV rows (label, bench, metric, value, unit), for tracking across commits.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class BenchReport {
+public:
+    BenchReport() : csv(false), header(true) {}
+
+    // Reads --csv, --json, --no-header and --label <name> from the command line, ignoring anything else
+    void parseArgs(int argc, char* argv[]) {
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], "--csv") == 0) csv = true;
+            else if (std::strcmp(argv[i], "--json") == 0) csv = false;
+            else if (std::strcmp(argv[i], "--no-header") == 0) header = false;
+            else if (std::strcmp(argv[i], "--label") == 0 && i + 1 < argc) label = argv[++i];
+        }
+    }
+
+    void add(const std::string& bench, const std::string& metric, double value, const std::string& unit) {
+        rows.push_back({ bench, metric, unit, value });
+    }
+
+    // Adds mean, p50, p90, p99 and max of the samples
+    void addDistribution(const std::string& bench, std::vector<double> samples, const std::string& unit) {
+        if (samples.empty()) return;
+        std::sort(samples.begin(), samples.end());
+        double sum = 0; for (double s : samples) sum += s;
+        size_t n = samples.size();
+        add(bench, "mean", sum / n, unit);
+        add(bench, "p50", samples[n / 2], unit);
+        add(bench, "p90", samples[n * 90 / 100], unit);
+        add(bench, "p99", samples[n * 99 / 100], unit);
+        add(bench, "max", samples.back(), unit);
+    }
+
+    void write(std::ostream& out) const {
+        if (csv && header) out << "label,bench,metric,value,unit\n";
+        for (const Row& r : rows) {
+            char value[32]; std::snprintf(value, sizeof(value), "%.6g", r.value);
+            if (csv) out << csvField(label) << ',' << r.bench << ',' << r.metric << ',' << value << ',' << r.unit << '\n';
+            else out << "{\"label\":\"" << jsonEscape(label) << "\",\"bench\":\"" << r.bench << "\",\"metric\":\"" << r.metric
+                     << "\",\"value\":" << value << ",\"unit\":\"" << r.unit << "\"}\n";
+        }
+    }
+
+private:
+    struct Row { std::string bench, metric, unit; double value; };
+    bool csv, header;
+    std::string label;
+    std::vector<Row> rows;
+
+    // The label is the only free text (bench, metric and unit names are literals in the benchmarks)
+    static std::string jsonEscape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') { out += '\\'; out += c; }
+            else if ((unsigned char)c < 0x20) { char esc[8]; std::snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)c); out += esc; }
+            else out += c;
+        }
+        return out;
+    }
+    // Quoted, with quotes doubled, if it holds a comma, a quote or a line break
+    static std::string csvField(const std::string& s) {
+        if (s.find_first_of(",\"\r\n") == std::string::npos) return s;
+        std::string out = "\"";
+        for (char c : s) { if (c == '"') out += '"'; out += c; }
+        return out + '"';
+    }
+};
@@ -0,0 +1,189 @@
+#include "cube_batch.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CUBE_BATCH_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CUBE_BATCH_NEON 1
+#endif
+
+namespace {
+
+const uint8_t TWIST = 16; // one unit of twist or flip in a packed byte
+const int INTERLEAVE = 4; // cubes advanced together, so one cube's dependent shuffle/add/min chain overlaps the others'
+
+// Byte k of a move's result is half[shuffle[k]] + delta[k] (shuffle indexes within its 16-byte half),
+// then reduced by modulus[k]: 3 twists in the corner half, 2 flips in the edge half
+struct PackedMove { alignas(32) uint8_t shuffle[32]; alignas(32) uint8_t delta[32]; };
+struct PackedMoves {
+    PackedMove moves[MOVE_NONE];
+    alignas(32) uint8_t modulus[32];
+    // From CubeState itself (a move applied to the solved cube is that move's permutation and
+    // orientation changes), so the two can't disagree
+    PackedMoves() {
+        for (int m = 0; m < MOVE_NONE; m++) {
+            CubeState s; s.apply((MoveType)m);
+            PackedMove& p = moves[m];
+            for (int i = 0; i < 16; i++) { p.shuffle[i] = p.shuffle[16 + i] = (uint8_t)i; p.delta[i] = p.delta[16 + i] = 0; }
+            for (int i = 0; i < 8; i++) { p.shuffle[i] = s.cp[i]; p.delta[i] = (uint8_t)(s.co[i] * TWIST); }
+            for (int i = 0; i < 6; i++) p.shuffle[8 + i] = (uint8_t)(8 + s.centers[i]);
+            for (int i = 0; i < 12; i++) { p.shuffle[16 + i] = s.ep[i]; p.delta[16 + i] = (uint8_t)(s.eo[i] * TWIST); }
+        }
+        for (int i = 0; i < 16; i++) { modulus[i] = 3 * TWIST; modulus[16 + i] = 2 * TWIST; }
+    }
+};
+
+const PackedMoves& packedMoves() { static const PackedMoves t; return t; }
+
+typedef void (*ApplyFn)(uint8_t* cubes, size_t count, const uint8_t* moves, size_t moveCount);
+
+void applyScalar(uint8_t* cubes, size_t count, const uint8_t* moves, size_t moveCount) {
+    const PackedMoves& t = packedMoves();
+    for (size_t c = 0; c < count; c++) {
+        uint8_t* b = cubes + c * 32;
+        for (size_t k = 0; k < moveCount; k++) {
+            const PackedMove& p = t.moves[moves[k]];
+            uint8_t out[32];
+            for (int i = 0; i < 32; i++) {
+                uint8_t v = (uint8_t)(b[(i & 16) | p.shuffle[i]] + p.delta[i]);
+                out[i] = v >= t.modulus[i] ? (uint8_t)(v - t.modulus[i]) : v;
+            }
+            std::memcpy(b, out, 32);
+        }
+    }
+}
+
+#if CUBE_BATCH_X86
+// Unsigned min with the value minus the modulus wraps below zero unless the value has reached it
+__attribute__((target("avx2"))) void applyAvx2(uint8_t* cubes, size_t count, const uint8_t* moves, size_t moveCount) {
+    const PackedMoves& t = packedMoves();
+    const __m256i mod = _mm256_load_si256((const __m256i*)t.modulus);
+    size_t c = 0;
+    for (; c + INTERLEAVE <= count; c += INTERLEAVE) {
+        __m256i v[INTERLEAVE];
+        for (int j = 0; j < INTERLEAVE; j++) v[j] = _mm256_load_si256((const __m256i*)(cubes + (c + j) * 32));
+        for (size_t k = 0; k < moveCount; k++) {
+            const PackedMove& p = t.moves[moves[k]];
+            const __m256i shuffle = _mm256_load_si256((const __m256i*)p.shuffle), delta = _mm256_load_si256((const __m256i*)p.delta);
+            for (int j = 0; j < INTERLEAVE; j++) {
+                v[j] = _mm256_add_epi8(_mm256_shuffle_epi8(v[j], shuffle), delta);
+                v[j] = _mm256_min_epu8(v[j], _mm256_sub_epi8(v[j], mod));
+            }
+        }
+        for (int j = 0; j < INTERLEAVE; j++) _mm256_store_si256((__m256i*)(cubes + (c + j) * 32), v[j]);
+    }
+    if (c < count) applyScalar(cubes + c * 32, count - c, moves, moveCount);
+}
+
+__attribute__((target("ssse3"))) void applySsse3(uint8_t* cubes, size_t count, const uint8_t* moves, size_t moveCount) {
+    const PackedMoves& t = packedMoves();
+    const __m128i modCorner = _mm_load_si128((const __m128i*)t.modulus), modEdge = _mm_load_si128((const __m128i*)(t.modulus + 16));
+    size_t c = 0;
+    for (; c + INTERLEAVE <= count; c += INTERLEAVE) {
+        __m128i corners[INTERLEAVE], edges[INTERLEAVE];
+        for (int j = 0; j < INTERLEAVE; j++) {
+            corners[j] = _mm_load_si128((const __m128i*)(cubes + (c + j) * 32));
+            edges[j] = _mm_load_si128((const __m128i*)(cubes + (c + j) * 32 + 16));
+        }
+        for (size_t k = 0; k < moveCount; k++) {
+            const PackedMove& p = t.moves[moves[k]];
+            const __m128i cs = _mm_load_si128((const __m128i*)p.shuffle), es = _mm_load_si128((const __m128i*)(p.shuffle + 16));
+            const __m128i cd = _mm_load_si128((const __m128i*)p.delta), ed = _mm_load_si128((const __m128i*)(p.delta + 16));
+            for (int j = 0; j < INTERLEAVE; j++) {
+                corners[j] = _mm_add_epi8(_mm_shuffle_epi8(corners[j], cs), cd);
+                corners[j] = _mm_min_epu8(corners[j], _mm_sub_epi8(corners[j], modCorner));
+                edges[j] = _mm_add_epi8(_mm_shuffle_epi8(edges[j], es), ed);
+                edges[j] = _mm_min_epu8(edges[j], _mm_sub_epi8(edges[j], modEdge));
+            }
+        }
+        for (int j = 0; j < INTERLEAVE; j++) {
+            _mm_store_si128((__m128i*)(cubes + (c + j) * 32), corners[j]);
+            _mm_store_si128((__m128i*)(cubes + (c + j) * 32 + 16), edges[j]);
+        }
+    }
+    if (c < count) applyScalar(cubes + c * 32, count - c, moves, moveCount);
+}
+#endif
+
+#if CUBE_BATCH_NEON
+void applyNeon(uint8_t* cubes, size_t count, const uint8_t* moves, size_t moveCount) {
+    const PackedMoves& t = packedMoves();
+    const uint8x16_t modCorner = vld1q_u8(t.modulus), modEdge = vld1q_u8(t.modulus + 16);
+    size_t c = 0;
+    for (; c + INTERLEAVE <= count; c += INTERLEAVE) {
+        uint8x16_t corners[INTERLEAVE], edges[INTERLEAVE];
+        for (int j = 0; j < INTERLEAVE; j++) { corners[j] = vld1q_u8(cubes + (c + j) * 32); edges[j] = vld1q_u8(cubes + (c + j) * 32 + 16); }
+        for (size_t k = 0; k < moveCount; k++) {
+            const PackedMove& p = t.moves[moves[k]];
+            const uint8x16_t cs = vld1q_u8(p.shuffle), es = vld1q_u8(p.shuffle + 16), cd = vld1q_u8(p.delta), ed = vld1q_u8(p.delta + 16);
+            for (int j = 0; j < INTERLEAVE; j++) {
+                corners[j] = vaddq_u8(vqtbl1q_u8(corners[j], cs), cd);
+                corners[j] = vminq_u8(corners[j], vsubq_u8(corners[j], modCorner));
+                edges[j] = vaddq_u8(vqtbl1q_u8(edges[j], es), ed);
+                edges[j] = vminq_u8(edges[j], vsubq_u8(edges[j], modEdge));
+            }
+        }
+        for (int j = 0; j < INTERLEAVE; j++) { vst1q_u8(cubes + (c + j) * 32, corners[j]); vst1q_u8(cubes + (c + j) * 32 + 16, edges[j]); }
+    }
+    if (c < count) applyScalar(cubes + c * 32, count - c, moves, moveCount);
+}
+#endif
+
+struct Dispatch { ApplyFn fn; const char* name; };
+
+Dispatch pick() {
+#if CUBE_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return { applyAvx2, "avx2" };
+    if (__builtin_cpu_supports("ssse3")) return { applySsse3, "ssse3" };
+#elif CUBE_BATCH_NEON
+    return { applyNeon, "neon" };
+#endif
+    return { applyScalar, "scalar" };
+}
+
+const Dispatch& dispatch() { static const Dispatch d = pick(); return d; }
+
+} // namespace
+
+void CubeBatch::resize(size_t count) {
+    size_t old = cubes.size();
+    cubes.resize(count);
+    for (size_t i = old; i < count; i++) set(i, CubeState());
+}
+
+void CubeBatch::set(size_t i, const CubeState& s) {
+    uint8_t* b = cubes[i].bytes;
+    std::memset(b, 0, 32);
+    for (int k = 0; k < 8; k++) b[k] = (uint8_t)(s.cp[k] | s.co[k] * TWIST);
+    for (int k = 0; k < 6; k++) b[8 + k] = s.centers[k];
+    for (int k = 0; k < 12; k++) b[16 + k] = (uint8_t)(s.ep[k] | s.eo[k] * TWIST);
+}
+
+CubeState CubeBatch::get(size_t i) const {
+    const uint8_t* b = cubes[i].bytes;
+    CubeState s;
+    for (int k = 0; k < 8; k++) { s.cp[k] = b[k] & 15; s.co[k] = b[k] / TWIST; }
+    for (int k = 0; k < 6; k++) s.centers[k] = b[8 + k];
+    for (int k = 0; k < 12; k++) { s.ep[k] = b[16 + k] & 15; s.eo[k] = b[16 + k] / TWIST; }
+    return s;
+}
+
+bool CubeBatch::isSolved(size_t i) const {
+    static const CubeBatch solved(1);
+    return std::memcmp(cubes[i].bytes, solved.cubes[0].bytes, 32) == 0;
+}
+
+void CubeBatch::apply(const MoveType* moves, int count) {
+    uint8_t valid[256]; // skipping MOVE_NONE (and anything out of range) up front keeps the inner loops branch-free
+    for (int k = 0; k < count;) {
+        size_t n = 0;
+        for (; k < count && n < sizeof(valid); k++) if (moves[k] >= 0 && moves[k] < MOVE_NONE) valid[n++] = (uint8_t)moves[k];
+        if (n && !cubes.empty()) dispatch().fn(cubes[0].bytes, cubes.size(), valid, n);
+    }
+}
+
+const char* CubeBatch::instructionSet() { return dispatch().name; }
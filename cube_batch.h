@@ -0,0 +1,34 @@
+#pragma once
+// Many CubeStates packed for SIMD: each cube is 32 bytes, corners (piece | twist << 4) and centers in
+// the first 16, edges (piece | flip << 4) in the second. A move is then a byte shuffle of each half,
+// an add of the twists/flips it causes and a min that reduces them mod 3/2: one AVX2 instruction each
+// per cube, two with SSSE3 or NEON. The instruction set is picked at run time on x86.
+#include "cube_state.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CubeBatch {
+public:
+    explicit CubeBatch(size_t count = 0) { resize(count); }
+
+    size_t size() const { return cubes.size(); }
+    void resize(size_t count); // added cubes are solved
+    void set(size_t i, const CubeState& s);
+    CubeState get(size_t i) const;
+    bool isSolved(size_t i) const;
+
+    // The same moves on every cube. The sequence form keeps each cube in registers for the whole
+    // sequence, so it is the fast one; one move at a time streams the whole batch through memory.
+    void apply(MoveType move) { apply(&move, 1); }
+    void apply(const MoveType* moves, int count);
+    void apply(const std::vector<MoveType>& moves) { apply(moves.data(), (int)moves.size()); }
+
+    // The code path apply() takes on this machine: "avx2", "ssse3", "neon" or "scalar"
+    static const char* instructionSet();
+
+private:
+    struct alignas(32) Packed { uint8_t bytes[32]; };
+    std::vector<Packed> cubes;
+};
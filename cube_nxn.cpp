@@ -0,0 +1,99 @@
+#include "cube_nxn.h"
+
+#include <algorithm>
+
+namespace {
+
+const Face dirFace[6] = { FACE_R, FACE_L, FACE_U, FACE_D, FACE_F, FACE_B };
+// Row and column axis of the faces normal to x, y and z
+const int rowAxis[3] = { 1, 0, 0 }, colAxis[3] = { 2, 2, 1 };
+
+struct Pos { int c[3]; };
+
+// q quarter turns counterclockwise about axis through the cube center; last = size - 1
+// (0 rotates a direction vector instead of a grid position)
+Pos rotate(Pos p, int axis, int last, int q) {
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    for (int i = 0; i < q; i++) { int t = p.c[u]; p.c[u] = last - p.c[v]; p.c[v] = t; }
+    return p;
+}
+
+FaceDir rotate(FaceDir d, int axis, int q) {
+    Pos v = { { 0, 0, 0 } }; v.c[d / 2] = (d % 2) ? -1 : 1;
+    v = rotate(v, axis, 0, q);
+    for (int a = 0; a < 3; a++) if (v.c[a]) return (FaceDir)(2 * a + (v.c[a] < 0));
+    return d;
+}
+
+} // namespace
+
+LayerTurn layerTurn(MoveType move, int size) {
+    MoveGeometry g = moveGeometry(move);
+    int layer = g.layer < 0 ? 0 : g.layer > 0 ? size - 1 : (size % 2 ? size / 2 : -1);
+    if (layer < 0) return { g.axis, 0, 0 };
+    return { g.axis, layer, g.quarterTurns };
+}
+
+void randomTurns(Xoshiro256& rng, int size, int count, std::vector<LayerTurn>& out) {
+    for (int i = 0; i < count; i++) {
+        int axis = (int)rng.below(3), layer = (int)rng.below((uint32_t)size);
+        out.push_back({ axis, layer, rng.below(2) ? 1 : -1 });
+    }
+}
+
+CubeNxN::CubeNxN(int size) : n(std::min(CUBE_MAX_SIZE, std::max(CUBE_MIN_SIZE, size))), stickers((size_t)6 * n * n) {
+    for (int d = 0; d < 6; d++) std::fill(stickers.begin() + (size_t)d * n * n, stickers.begin() + (size_t)(d + 1) * n * n, (uint8_t)dirFace[d]);
+}
+
+void CubeNxN::turn(int axis, int layer, int quarterTurns) {
+    int q = ((quarterTurns % 4) + 4) % 4;
+    if (q == 0 || axis < 0 || axis > 2 || layer < 0 || layer >= n) return;
+    const int last = n - 1, area = n * n;
+    auto index = [&](FaceDir d, const Pos& p) { int a = d / 2; return d * area + p.c[rowAxis[a]] * n + p.c[colAxis[a]]; };
+
+    // The layer crosses each side face in one row or column: read all four, then write each to the
+    // face it turns onto. Position k and k+1 of a strip stay neighbours, so a strip is a start and a stride.
+    uint8_t strips[4][CUBE_MAX_SIZE];
+    int to[4], toStride[4], s = 0;
+    for (int f = 0; f < 6; f++) {
+        FaceDir d = (FaceDir)f;
+        if (d / 2 == axis) continue;
+        int other = 3 - axis - d / 2;
+        Pos p0 = { { 0, 0, 0 } }; p0.c[axis] = layer; p0.c[d / 2] = (d % 2) ? 0 : last;
+        Pos p1 = p0; p1.c[other] = 1;
+        int from = index(d, p0), fromStride = index(d, p1) - from;
+        for (int k = 0; k < n; k++) strips[s][k] = stickers[from + k * fromStride];
+        FaceDir e = rotate(d, axis, q);
+        to[s] = index(e, rotate(p0, axis, last, q)); toStride[s] = index(e, rotate(p1, axis, last, q)) - to[s];
+        s++;
+    }
+    for (s = 0; s < 4; s++) for (int k = 0; k < n; k++) stickers[to[s] + k * toStride[s]] = strips[s][k];
+
+    // An outer layer also turns the face it covers in place
+    for (int end = 0; end < 2; end++) {
+        if (layer != (end ? last : 0)) continue;
+        FaceDir d = (FaceDir)(2 * axis + (end ? 0 : 1));
+        uint8_t old[CUBE_MAX_SIZE * CUBE_MAX_SIZE];
+        std::copy(stickers.begin() + d * area, stickers.begin() + (d + 1) * area, old);
+        Pos p = { { 0, 0, 0 } }; p.c[axis] = layer;
+        for (int r = 0; r < n; r++) for (int c = 0; c < n; c++) {
+            p.c[rowAxis[axis]] = r; p.c[colAxis[axis]] = c;
+            stickers[index(d, rotate(p, axis, last, q))] = old[r * n + c];
+        }
+    }
+}
+
+bool CubeNxN::isSolved() const {
+    const int area = n * n;
+    for (int d = 0; d < 6; d++) {
+        const uint8_t* f = face((FaceDir)d);
+        if (std::find_if(f, f + area, [f](uint8_t c) { return c != f[0]; }) != f + area) return false;
+    }
+    return true;
+}
+
+Face CubeNxN::facelet(int x, int y, int z, FaceDir dir) const {
+    int p[3] = { x, y, z }, a = dir / 2;
+    if (p[a] != ((dir % 2) ? 0 : n - 1)) return FACE_NONE;
+    return (Face)face(dir)[p[rowAxis[a]] * n + p[colAxis[a]]];
+}
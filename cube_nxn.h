@@ -0,0 +1,43 @@
+#pragma once
+// NxNxN cube as sticker colors only, stored per face in contiguous arrays. A layer turn moves one
+// row or column of each of the four faces around its axis (plus the whole face for an outer layer),
+// so its cost grows with N instead of with the N^3 cubies. The 3x3x3 solver keeps using CubeState.
+#include "cube_state.h"
+#include "xoshiro.h"
+
+#include <cstdint>
+#include <vector>
+
+const int CUBE_MIN_SIZE = 2, CUBE_MAX_SIZE = 17;
+
+// Cubie coordinates here are grid indices 0..size-1 along each axis. A turn is axis 0/1/2 = x/y/z,
+// layer 0..size-1 along it, quarterTurns counterclockwise seen from the positive end (as MoveGeometry)
+struct LayerTurn { int axis, layer, quarterTurns; };
+
+// The layer turn of a 3x3 move on a size-N cube: faces turn the outer layers, M/E/S the middle one.
+// quarterTurns is 0 when there is no such layer (slices of an even cube).
+LayerTurn layerTurn(MoveType move, int size);
+// count random quarter turns of any layer
+void randomTurns(Xoshiro256& rng, int size, int count, std::vector<LayerTurn>& out);
+
+class CubeNxN {
+public:
+    explicit CubeNxN(int size = 3); // solved; size clamped to CUBE_MIN_SIZE..CUBE_MAX_SIZE
+
+    int size() const { return n; }
+    void turn(int axis, int layer, int quarterTurns);
+    void turn(const LayerTurn& t) { turn(t.axis, t.layer, t.quarterTurns); }
+    void apply(MoveType move) { turn(layerTurn(move, n)); }
+    // Every face one color (any orientation of the whole cube counts, as even cubes have no fixed centers)
+    bool isSolved() const;
+
+    // Color on face dir of the cubie at x,y,z, FACE_NONE unless that face is on the outside
+    Face facelet(int x, int y, int z, FaceDir dir) const;
+    // size*size stickers of face dir, row-major over its two other axes in x, y, z order
+    // (y,z for the X faces, x,z for Y, x,y for Z)
+    const uint8_t* face(FaceDir dir) const { return &stickers[(size_t)dir * n * n]; }
+
+private:
+    int n;
+    std::vector<uint8_t> stickers; // six faces in FaceDir order
+};
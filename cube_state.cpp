@@ -0,0 +1,270 @@
+#include "cube_state.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+// Everything below is built by constexpr functions, so the tables are constant-initialized data:
+// there is no start-up work and no static-initialization order to depend on from other files.
+struct Vec { int x, y, z; };
+constexpr bool operator==(const Vec& a, const Vec& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+constexpr Vec dirVec[6] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+constexpr Face dirFace[6] = { FACE_R, FACE_L, FACE_U, FACE_D, FACE_F, FACE_B };
+
+constexpr Vec cornerPos[8] = { {1,1,1}, {-1,1,1}, {-1,1,-1}, {1,1,-1}, {1,-1,1}, {-1,-1,1}, {-1,-1,-1}, {1,-1,-1} };
+// Facets listed clockwise, U/D facet first, so a twist is a cyclic shift
+constexpr FaceDir cornerFacets[8][3] = {
+    {POS_Y, POS_X, POS_Z}, {POS_Y, POS_Z, NEG_X}, {POS_Y, NEG_X, NEG_Z}, {POS_Y, NEG_Z, POS_X},
+    {NEG_Y, POS_Z, POS_X}, {NEG_Y, NEG_X, POS_Z}, {NEG_Y, NEG_Z, NEG_X}, {NEG_Y, POS_X, NEG_Z}
+};
+constexpr Vec edgePos[12] = { {1,1,0}, {0,1,1}, {-1,1,0}, {0,1,-1}, {1,-1,0}, {0,-1,1}, {-1,-1,0}, {0,-1,-1}, {1,0,1}, {-1,0,1}, {-1,0,-1}, {1,0,-1} };
+constexpr FaceDir edgeFacets[12][2] = {
+    {POS_Y, POS_X}, {POS_Y, POS_Z}, {POS_Y, NEG_X}, {POS_Y, NEG_Z}, {NEG_Y, POS_X}, {NEG_Y, POS_Z},
+    {NEG_Y, NEG_X}, {NEG_Y, NEG_Z}, {POS_Z, POS_X}, {POS_Z, NEG_X}, {NEG_Z, NEG_X}, {NEG_Z, POS_X}
+};
+constexpr FaceDir centerFacet[6] = { POS_Y, POS_X, POS_Z, NEG_Y, NEG_X, NEG_Z };
+
+// Axis, layer and direction of each quarter turn (dir +1 = counterclockwise seen from the positive axis)
+struct QuarterGeometry { int axis, layer, dir; };
+constexpr QuarterGeometry quarterGeometry[MOVE_F2] = {
+    {2, 1,-1}, {2, 1, 1}, {2,-1, 1}, {2,-1,-1}, {0,-1, 1}, {0,-1,-1}, {0, 1,-1}, {0, 1, 1}, {1, 1,-1},
+    {1, 1, 1}, {1,-1, 1}, {1,-1,-1}, {0, 0, 1}, {0, 0,-1}, {1, 0, 1}, {1, 0,-1}, {2, 0,-1}, {2, 0, 1}
+};
+
+// A move in "slot j receives the piece from slot perm[j], twisted by ori[j]" form
+struct MoveDef {
+    uint8_t cp[8], co[8];
+    uint8_t ep[12], eo[12];
+    uint8_t centers[6];
+};
+
+constexpr uint8_t mod3[6] = { 0, 1, 2, 0, 1, 2 };
+
+constexpr int coord(const Vec& v, int axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+constexpr int slotIndex(const Vec& v) { return (v.x + 1) * 9 + (v.y + 1) * 3 + (v.z + 1); }
+constexpr Vec slotPos(int slot) { return { slot / 9 - 1, slot / 3 % 3 - 1, slot % 3 - 1 }; }
+
+// One quarter turn about the center, counterclockwise (dir +1) or clockwise seen from the positive axis
+constexpr Vec rotate(const Vec& v, int axis, int dir) {
+    if (axis == 0) return dir > 0 ? Vec{ v.x, -v.z, v.y } : Vec{ v.x, v.z, -v.y };
+    if (axis == 1) return dir > 0 ? Vec{ v.z, v.y, -v.x } : Vec{ -v.z, v.y, v.x };
+    return dir > 0 ? Vec{ -v.y, v.x, v.z } : Vec{ v.y, -v.x, v.z };
+}
+
+constexpr int dirIndex(const Vec& v) {
+    for (int d = 0; d < 6; d++) if (dirVec[d] == v) return d;
+    return 0;
+}
+
+template <int N, int K>
+constexpr void buildPieceMove(const Vec (&pos)[N], const FaceDir (&facets)[N][K], const QuarterGeometry& g, uint8_t* perm, uint8_t* ori) {
+    for (int i = 0; i < N; i++) { perm[i] = (uint8_t)i; ori[i] = 0; }
+    for (int i = 0; i < N; i++) {
+        if (coord(pos[i], g.axis) != g.layer) continue;
+        Vec p = rotate(pos[i], g.axis, g.dir), ref = rotate(dirVec[facets[i][0]], g.axis, g.dir);
+        for (int j = 0; j < N; j++) {
+            if (!(pos[j] == p)) continue;
+            perm[j] = (uint8_t)i;
+            for (int k = 0; k < K; k++) if (dirVec[facets[j][k]] == ref) ori[j] = (uint8_t)k;
+        }
+    }
+}
+
+// a followed by b
+constexpr MoveDef compose(const MoveDef& a, const MoveDef& b) {
+    MoveDef c{};
+    for (int i = 0; i < 8; i++) { c.cp[i] = a.cp[b.cp[i]]; c.co[i] = mod3[a.co[b.cp[i]] + b.co[i]]; }
+    for (int i = 0; i < 12; i++) { c.ep[i] = a.ep[b.ep[i]]; c.eo[i] = a.eo[b.ep[i]] ^ b.eo[i]; }
+    for (int i = 0; i < 6; i++) c.centers[i] = a.centers[b.centers[i]];
+    return c;
+}
+
+struct MoveTables {
+    MoveDef moves[MOVE_NONE];        // piece permutations for CubeState
+    MoveTable cubie[MOVE_NONE + 1];  // slot and sticker permutations, MOVE_NONE last as the identity
+    MoveType layerMoves[3][3][4];    // [axis][layer + 1][quarter turns mod 4]
+};
+
+constexpr MoveTables buildMoveTables() {
+    MoveTables t{};
+    for (int m = 0; m < MOVE_F2; m++) {
+        const QuarterGeometry& g = quarterGeometry[m];
+        MoveDef& d = t.moves[m];
+        buildPieceMove(cornerPos, cornerFacets, g, d.cp, d.co);
+        buildPieceMove(edgePos, edgeFacets, g, d.ep, d.eo);
+        for (int f = 0; f < 6; f++) d.centers[f] = (uint8_t)f;
+        for (int f = 0; f < 6; f++) {
+            if (coord(dirVec[centerFacet[f]], g.axis) != g.layer) continue;
+            Vec p = rotate(dirVec[centerFacet[f]], g.axis, g.dir);
+            for (int j = 0; j < 6; j++) if (dirVec[centerFacet[j]] == p) d.centers[j] = (uint8_t)f;
+        }
+        MoveTable& c = t.cubie[m];
+        c.geometry = { g.axis, g.layer, g.dir };
+        for (int s = 0; s < 27; s++) c.slotTo[s] = (uint8_t)(coord(slotPos(s), g.axis) == g.layer ? slotIndex(rotate(slotPos(s), g.axis, g.dir)) : s);
+        for (int f = 0; f < 6; f++) c.dirFrom[dirIndex(rotate(dirVec[f], g.axis, g.dir))] = (uint8_t)f;
+    }
+    for (int h = 0; h < MOVE_NONE - MOVE_F2; h++) {
+        const MoveTable& q = t.cubie[2 * h];
+        MoveTable& c = t.cubie[MOVE_F2 + h];
+        t.moves[MOVE_F2 + h] = compose(t.moves[2 * h], t.moves[2 * h]);
+        c.geometry = { q.geometry.axis, q.geometry.layer, 2 };
+        for (int s = 0; s < 27; s++) c.slotTo[s] = q.slotTo[q.slotTo[s]];
+        for (int f = 0; f < 6; f++) c.dirFrom[f] = q.dirFrom[q.dirFrom[f]];
+    }
+    MoveTable& none = t.cubie[MOVE_NONE];
+    none.geometry = { 0, 0, 0 };
+    for (int s = 0; s < 27; s++) none.slotTo[s] = (uint8_t)s;
+    for (int f = 0; f < 6; f++) none.dirFrom[f] = (uint8_t)f;
+
+    for (int a = 0; a < 3; a++) for (int l = 0; l < 3; l++) for (int q = 0; q < 4; q++) t.layerMoves[a][l][q] = MOVE_NONE;
+    for (int m = 0; m < MOVE_NONE; m++) {
+        const MoveGeometry& g = t.cubie[m].geometry;
+        t.layerMoves[g.axis][g.layer + 1][(g.quarterTurns + 4) % 4] = (MoveType)m;
+    }
+    return t;
+}
+
+constexpr MoveTables tables = buildMoveTables();
+
+// Four quarter turns of any layer put every cubie and sticker back
+constexpr bool quarterTurnsCycle() {
+    for (int m = 0; m < MOVE_F2; m++) {
+        const MoveTable& c = tables.cubie[m];
+        for (int s = 0; s < 27; s++) if (c.slotTo[c.slotTo[c.slotTo[c.slotTo[s]]]] != s) return false;
+        for (int f = 0; f < 6; f++) if (c.dirFrom[c.dirFrom[c.dirFrom[c.dirFrom[f]]]] != f) return false;
+    }
+    return true;
+}
+static_assert(quarterTurnsCycle(), "move tables: a quarter turn must have order four");
+static_assert(tables.layerMoves[0][2][3] == MOVE_R && tables.layerMoves[1][1][1] == MOVE_E, "move tables: layer lookup");
+
+// Sticker lookup per cubie slot (index (x+1)*9 + (y+1)*3 + (z+1)) and face direction
+enum SlotKind : uint8_t { SLOT_NONE, SLOT_CORNER, SLOT_EDGE, SLOT_CENTER };
+struct SlotFacet { SlotKind kind; uint8_t index, facet; };
+
+struct FaceletTable {
+    SlotFacet slots[27][6];
+    Face cornerColor[8][3], edgeColor[12][2];
+};
+
+constexpr FaceletTable buildFaceletTable() {
+    FaceletTable t{};
+    for (int i = 0; i < 8; i++) for (int k = 0; k < 3; k++) { t.slots[slotIndex(cornerPos[i])][cornerFacets[i][k]] = { SLOT_CORNER, (uint8_t)i, (uint8_t)k }; t.cornerColor[i][k] = dirFace[cornerFacets[i][k]]; }
+    for (int i = 0; i < 12; i++) for (int k = 0; k < 2; k++) { t.slots[slotIndex(edgePos[i])][edgeFacets[i][k]] = { SLOT_EDGE, (uint8_t)i, (uint8_t)k }; t.edgeColor[i][k] = dirFace[edgeFacets[i][k]]; }
+    for (int f = 0; f < 6; f++) t.slots[slotIndex(dirVec[centerFacet[f]])][centerFacet[f]] = { SLOT_CENTER, (uint8_t)f, 0 };
+    return t;
+}
+
+constexpr FaceletTable faceletTable = buildFaceletTable();
+
+} // namespace
+
+CubeState::CubeState() {
+    for (int i = 0; i < 8; i++) { cp[i] = i; co[i] = 0; }
+    for (int i = 0; i < 12; i++) { ep[i] = i; eo[i] = 0; }
+    for (int i = 0; i < 6; i++) centers[i] = i;
+}
+
+void CubeState::apply(MoveType move) {
+    if (move < 0 || move >= MOVE_NONE) return;
+    const MoveDef& m = tables.moves[move];
+    CubeState s = *this;
+    for (int i = 0; i < 8; i++) { cp[i] = s.cp[m.cp[i]]; co[i] = mod3[s.co[m.cp[i]] + m.co[i]]; }
+    for (int i = 0; i < 12; i++) { ep[i] = s.ep[m.ep[i]]; eo[i] = s.eo[m.ep[i]] ^ m.eo[i]; }
+    for (int i = 0; i < 6; i++) centers[i] = s.centers[m.centers[i]];
+}
+
+bool CubeState::isSolved() const { return *this == CubeState(); }
+
+bool CubeState::operator==(const CubeState& o) const {
+    return std::memcmp(cp, o.cp, sizeof(cp)) == 0 && std::memcmp(co, o.co, sizeof(co)) == 0 &&
+           std::memcmp(ep, o.ep, sizeof(ep)) == 0 && std::memcmp(eo, o.eo, sizeof(eo)) == 0 &&
+           std::memcmp(centers, o.centers, sizeof(centers)) == 0;
+}
+
+Face CubeState::facelet(int x, int y, int z, FaceDir dir) const {
+    const SlotFacet& s = faceletTable.slots[(x + 1) * 9 + (y + 1) * 3 + (z + 1)][dir];
+    switch (s.kind) {
+        case SLOT_CORNER: return faceletTable.cornerColor[cp[s.index]][mod3[s.facet + 3 - co[s.index]]];
+        case SLOT_EDGE: return faceletTable.edgeColor[ep[s.index]][s.facet ^ eo[s.index]];
+        case SLOT_CENTER: return (Face)centers[s.index];
+        default: return FACE_NONE;
+    }
+}
+
+std::string CubeState::facelets() const {
+    static const char letters[] = "URFDLB";
+    // Per face: sticker direction, then the cubie coordinates of the first sticker and the column/row steps
+    struct FaceScan { FaceDir dir; int origin[3], col[3], row[3]; };
+    static const FaceScan scans[6] = {
+        { POS_Y, {-1, 1,-1}, {1,0,0}, {0,0,1} },  { POS_X, { 1, 1, 1}, {0,0,-1}, {0,-1,0} },
+        { POS_Z, {-1, 1, 1}, {1,0,0}, {0,-1,0} }, { NEG_Y, {-1,-1, 1}, {1,0,0}, {0,0,-1} },
+        { NEG_X, {-1, 1,-1}, {0,0,1}, {0,-1,0} }, { NEG_Z, { 1, 1,-1}, {-1,0,0}, {0,-1,0} }
+    };
+    std::string out;
+    for (const FaceScan& f : scans)
+        for (int r = 0; r < 3; r++) for (int c = 0; c < 3; c++) {
+            int p[3];
+            for (int k = 0; k < 3; k++) p[k] = f.origin[k] + c * f.col[k] + r * f.row[k];
+            out += letters[facelet(p[0], p[1], p[2], f.dir)];
+        }
+    return out;
+}
+
+const char* moveName(MoveType move) {
+    static const char* const names[MOVE_NONE] = { "F", "F'", "B", "B'", "L", "L'", "R", "R'", "U", "U'", "D", "D'", "M", "M'", "E", "E'", "S", "S'",
+                                                  "F2", "B2", "L2", "R2", "U2", "D2", "M2", "E2", "S2" };
+    return (move >= 0 && move < MOVE_NONE) ? names[move] : "?";
+}
+
+bool parseMoves(const std::string& text, std::vector<MoveType>& out) {
+    static const char faces[] = "FBLRUDMES";
+    std::istringstream in(text);
+    std::string token;
+    while (in >> token) {
+        const char* f = token.size() <= 2 ? std::strchr(faces, token[0]) : nullptr;
+        if (!f || !*f) return false;
+        MoveType m = static_cast<MoveType>((f - faces) * 2);
+        if (token.size() == 1) out.push_back(m);
+        else if (token[1] == '\'') out.push_back(static_cast<MoveType>(m + 1));
+        else if (token[1] == '2') out.push_back(static_cast<MoveType>(MOVE_F2 + (f - faces)));
+        else return false;
+    }
+    return true;
+}
+
+std::string formatMoves(const MoveType* moves, size_t count) {
+    std::string out;
+    for (size_t i = 0; i < count; i++) { if (i) out += ' '; out += moveName(moves[i]); }
+    return out;
+}
+
+MoveGeometry moveGeometry(MoveType move) { return moveTable(move).geometry; }
+
+const MoveTable& moveTable(MoveType move) { return tables.cubie[(move >= 0 && move < MOVE_NONE) ? move : MOVE_NONE]; }
+
+MoveType makeMove(int axis, int layer, int quarterTurns) {
+    if (axis < 0 || axis > 2 || layer < -1 || layer > 1) return MOVE_NONE;
+    return tables.layerMoves[axis][layer + 1][((quarterTurns % 4) + 4) % 4];
+}
+
+void optimizeMoves(std::vector<MoveType>& moves) {
+    // Runs of same-axis moves as quarter turns per layer; neighbouring runs always differ in axis
+    struct Run { int axis; int turns[3]; };
+    std::vector<Run> runs;
+    for (MoveType m : moves) {
+        MoveGeometry g = moveGeometry(m);
+        if (g.quarterTurns == 0) continue;
+        if (runs.empty() || runs.back().axis != g.axis) runs.push_back({ g.axis, { 0, 0, 0 } });
+        Run& r = runs.back();
+        r.turns[g.layer + 1] = (r.turns[g.layer + 1] + g.quarterTurns + 4) % 4;
+        if (!r.turns[0] && !r.turns[1] && !r.turns[2]) runs.pop_back();
+    }
+    moves.clear();
+    for (const Run& r : runs)
+        for (int layer = -1; layer <= 1; layer++)
+            if (r.turns[layer + 1]) moves.push_back(makeMove(r.axis, layer, r.turns[layer + 1]));
+}
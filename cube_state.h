@@ -0,0 +1,78 @@
+#pragma once
+// Headless cube model: no GL/SDL/glm, so solvers and batch tools can link it directly.
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum MoveType {
+    MOVE_F, MOVE_F_PRIME, MOVE_B, MOVE_B_PRIME,
+    MOVE_L, MOVE_L_PRIME, MOVE_R, MOVE_R_PRIME,
+    MOVE_U, MOVE_U_PRIME, MOVE_D, MOVE_D_PRIME,
+    MOVE_M, MOVE_M_PRIME, MOVE_E, MOVE_E_PRIME,
+    MOVE_S, MOVE_S_PRIME,
+    // Half turns, in the same face order as the quarter-turn pairs above
+    MOVE_F2, MOVE_B2, MOVE_L2, MOVE_R2, MOVE_U2, MOVE_D2, MOVE_M2, MOVE_E2, MOVE_S2,
+    MOVE_NONE
+};
+
+inline bool isHalfTurn(MoveType m) { return m >= MOVE_F2 && m < MOVE_NONE; }
+// F <-> F', half turns are their own inverse
+inline MoveType inverseMove(MoveType m) { return (isHalfTurn(m) || m == MOVE_NONE) ? m : (MoveType)(m ^ 1); }
+
+enum FaceDir { POS_X=0, NEG_X, POS_Y, NEG_Y, POS_Z, NEG_Z };
+
+// Sticker colors, named after the face they belong to when solved (U=+Y, R=+X, F=+Z)
+enum Face { FACE_U=0, FACE_R, FACE_F, FACE_D, FACE_L, FACE_B, FACE_NONE=-1 };
+
+// Corner slots: URF, UFL, ULB, UBR, DFR, DLF, DBL, DRB
+// Edge slots:   UR, UF, UL, UB, DR, DF, DL, DB, FR, FL, BL, BR
+// Centers:      U, R, F, D, L, B (only slice moves M/E/S move them)
+// cp/ep hold the piece sitting in each slot, co/eo its twist/flip relative to the slot's
+// U/D (or F/B for the middle layer) facet.
+struct CubeState {
+    uint8_t cp[8], co[8];
+    uint8_t ep[12], eo[12];
+    uint8_t centers[6];
+
+    CubeState(); // solved
+
+    void apply(MoveType move);
+    void apply(const MoveType* moves, int count) { for (int i = 0; i < count; i++) apply(moves[i]); }
+    bool isSolved() const;
+    bool operator==(const CubeState& o) const;
+    bool operator!=(const CubeState& o) const { return !(*this == o); }
+
+    // Color of the sticker on face dir of the cubie at x,y,z (each in -1..1), FACE_NONE for plastic
+    Face facelet(int x, int y, int z, FaceDir dir) const;
+    // 54 letters from URFDLB: faces U R F D L B, each read row by row as seen from outside the cube,
+    // with B up for U, F up for D and U up for the side faces
+    std::string facelets() const;
+};
+
+// Layer and turn of a move: axis 0/1/2 = x/y/z, layer -1/0/1 along it, quarterTurns counterclockwise
+// seen from the positive end of the axis (-1, 1 or 2)
+struct MoveGeometry { int axis, layer, quarterTurns; };
+MoveGeometry moveGeometry(MoveType move);
+
+// What a move does to the 27 cubie slots (index (x+1)*9 + (y+1)*3 + (z+1)), generated at compile
+// time. CubeState's piece tables come from the same rotations, so the game's cubies, the instant
+// mover and the solver agree by construction.
+struct MoveTable {
+    MoveGeometry geometry;
+    uint8_t slotTo[27]; // where the cubie in each slot ends up (itself outside the layer)
+    uint8_t dirFrom[6]; // a turned cubie shows on face dir the sticker it had on dirFrom[dir]
+    bool turns(int x, int y, int z) const { int p[3] = { x, y, z }; return geometry.quarterTurns != 0 && p[geometry.axis] == geometry.layer; }
+};
+// MOVE_NONE (or anything out of range) gives the identity
+const MoveTable& moveTable(MoveType move);
+// The move turning that layer by quarterTurns (taken mod 4), MOVE_NONE for a multiple of four
+MoveType makeMove(int axis, int layer, int quarterTurns);
+// Moves on the same axis commute, so each run of them is collapsed to at most one turn per layer:
+// R R' vanishes, U U U becomes U', R L R becomes R2 L. The result leaves the cube in the same state.
+void optimizeMoves(std::vector<MoveType>& moves);
+
+// Notation: F, F' and F2; M turns like L, E like D, S like F
+const char* moveName(MoveType move);
+// Parses whitespace-separated moves; false on an unknown token
+bool parseMoves(const std::string& text, std::vector<MoveType>& out);
+std::string formatMoves(const MoveType* moves, size_t count);
@@ -0,0 +1,130 @@
+#include "cube_symmetry.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Left-right mirror of the corner slots URF UFL ULB UBR DFR DLF DBL DRB and edge slots UR UF UL UB DR DF DL DB FR FL BL BR
+const uint8_t cornerMirror[8] = { 1, 0, 3, 2, 5, 4, 7, 6 };
+const uint8_t edgeMirror[12] = { 2, 1, 0, 3, 6, 5, 4, 7, 9, 8, 11, 10 };
+const MoveType faceQuarter[6] = { MOVE_U, MOVE_R, MOVE_F, MOVE_D, MOVE_L, MOVE_B };
+
+// conjugate() in one pass per piece: slot i of the result holds piece to[s.cp[from[i]]], twisted by
+// twistTo[that piece] + s.co[from[i]] + twistAt[i], negated for a mirror (mirrors reverse twists)
+struct Symmetry {
+    uint8_t cornerFrom[8], cornerTo[8], cornerTwistTo[8], cornerTwistAt[8];
+    uint8_t edgeFrom[12], edgeTo[12], edgeFlipTo[12], edgeFlipAt[12];
+    bool mirror;
+    uint8_t face[6];
+};
+
+struct Symmetries {
+    Symmetry sym[N_SYM];
+    uint8_t twist[2][9]; // (sum mod 3), negated for [1]
+    Symmetries();
+};
+
+CubeState inverse(const CubeState& a) {
+    CubeState r;
+    for (int i = 0; i < 8; i++) { r.cp[a.cp[i]] = (uint8_t)i; r.co[a.cp[i]] = (uint8_t)((3 - a.co[i]) % 3); }
+    for (int i = 0; i < 12; i++) { r.ep[a.ep[i]] = (uint8_t)i; r.eo[a.ep[i]] = a.eo[i]; }
+    return r;
+}
+
+void conjugateCorners(const CubeState& s, const Symmetry& y, const uint8_t (&twist)[9], CubeState& out) {
+    for (int i = 0; i < 8; i++) {
+        int a = y.cornerFrom[i], p = s.cp[a];
+        out.cp[i] = y.cornerTo[p];
+        out.co[i] = twist[y.cornerTwistTo[p] + s.co[a] + y.cornerTwistAt[i]];
+    }
+}
+
+void conjugateEdges(const CubeState& s, const Symmetry& y, CubeState& out) {
+    for (int i = 0; i < 12; i++) {
+        int a = y.edgeFrom[i], p = s.ep[a];
+        out.ep[i] = y.edgeTo[p];
+        out.eo[i] = (uint8_t)((y.edgeFlipTo[p] + s.eo[a] + y.edgeFlipAt[i]) & 1);
+    }
+}
+
+// The rotations are every product of whole-cube x and y turns, those keeping U/D in place first
+Symmetries::Symmetries() {
+    for (int t = 0; t < 9; t++) { twist[0][t] = (uint8_t)(t % 3); twist[1][t] = (uint8_t)((3 - t % 3) % 3); }
+    const MoveType x[3] = { MOVE_R, MOVE_M_PRIME, MOVE_L_PRIME }, y[3] = { MOVE_U, MOVE_E_PRIME, MOVE_D_PRIME };
+    std::vector<CubeState> rotations(1);
+    for (size_t i = 0; i < rotations.size(); i++) {
+        for (const MoveType* g : { x, y }) {
+            CubeState n = rotations[i]; n.apply(g, 3);
+            bool seen = false;
+            for (const CubeState& r : rotations) seen = seen || r == n;
+            if (!seen) rotations.push_back(n);
+        }
+    }
+    std::vector<CubeState> ordered;
+    for (int keepsUD = 1; keepsUD >= 0; keepsUD--)
+        for (const CubeState& r : rotations)
+            if ((r.centers[FACE_U] == FACE_U || r.centers[FACE_U] == FACE_D) == (keepsUD != 0)) ordered.push_back(r);
+
+    for (int k = 0; k < N_SYM; k++) {
+        const CubeState& r = ordered[k / 2];
+        CubeState rInv = inverse(r);
+        Symmetry& s = sym[k];
+        s.mirror = (k & 1) != 0;
+        for (int i = 0; i < 8; i++) {
+            int j = s.mirror ? cornerMirror[i] : i;
+            s.cornerFrom[i] = r.cp[j]; s.cornerTwistAt[i] = r.co[j];
+            s.cornerTo[i] = s.mirror ? cornerMirror[rInv.cp[i]] : rInv.cp[i]; s.cornerTwistTo[i] = rInv.co[i];
+        }
+        for (int i = 0; i < 12; i++) {
+            int j = s.mirror ? edgeMirror[i] : i;
+            s.edgeFrom[i] = r.ep[j]; s.edgeFlipAt[i] = r.eo[j];
+            s.edgeTo[i] = s.mirror ? edgeMirror[rInv.ep[i]] : rInv.ep[i]; s.edgeFlipTo[i] = rInv.eo[i];
+        }
+    }
+    // A face's quarter turn conjugates to a quarter turn (the inverse one under a mirror) of the face it lands on
+    for (int k = 0; k < N_SYM; k++)
+        for (int f = 0; f < 6; f++) {
+            CubeState turned; turned.apply(faceQuarter[f]);
+            CubeState c; conjugateCorners(turned, sym[k], twist[k & 1], c); conjugateEdges(turned, sym[k], c);
+            for (int g = 0; g < 6; g++) {
+                CubeState q, inv; q.apply(faceQuarter[g]); inv.apply((MoveType)(faceQuarter[g] + 1));
+                if (c == q || c == inv) sym[k].face[f] = (uint8_t)g;
+            }
+        }
+}
+
+const Symmetries& symmetries() { static const Symmetries s; return s; }
+
+} // namespace
+
+CubeState conjugate(const CubeState& s, int sym) {
+    const Symmetries& y = symmetries();
+    CubeState out;
+    conjugateCorners(s, y.sym[sym], y.twist[sym & 1], out);
+    conjugateEdges(s, y.sym[sym], out);
+    return out;
+}
+
+int symmetryFace(int sym, int face) { return symmetries().sym[sym].face[face]; }
+
+// Corners are compared first and most conjugates already lose there, so their edges are never built
+int symmetryClass(const CubeState& s, int axis, CubeState& rep) {
+    const Symmetries& y = symmetries();
+    rep = s;
+    int repAxis = axis;
+    CubeState c;
+    for (int k = 1; k < N_SYM; k++) {
+        const Symmetry& sym = y.sym[k];
+        conjugateCorners(s, sym, y.twist[k & 1], c);
+        int order = std::memcmp(c.cp, rep.cp, 16); // cp then co
+        if (order > 0) continue;
+        conjugateEdges(s, sym, c);
+        if (order == 0) order = std::memcmp(c.ep, rep.ep, 24); // ep then eo
+        int a = axis < 0 ? -1 : sym.face[axis] % 3;
+        if (order > 0 || (order == 0 && a >= repAxis)) continue;
+        std::memcpy(rep.cp, c.cp, 16); std::memcpy(rep.ep, c.ep, 24);
+        repAxis = a;
+    }
+    return repAxis;
+}
@@ -0,0 +1,20 @@
+#pragma once
+// The 48 symmetries of the cube (24 rotations, each with or without the left-right mirror) acting on
+// CubeState by conjugation. Conjugating maps face turns to face turns, so symmetric states are the
+// same distance from solved and a search only needs one state per class.
+#include "cube_state.h"
+
+const int N_SYM = 48;
+// Symmetries 0 .. N_SYM_UD-1 keep the U/D axis in place (0 is the identity). Only those map corner
+// twist independently of the corner permutation, so the corner tables reduce by these 16.
+const int N_SYM_UD = 16;
+
+// S^-1 s S for the symmetry's rotation S, then mirrored for odd sym. The centers must be home.
+CubeState conjugate(const CubeState& s, int sym);
+// The face (Face order U R F D L B) a turn of face takes in a state conjugated by sym
+int symmetryFace(int sym, int face);
+
+// The smallest conjugate of s over all 48 symmetries, written to rep, for a state searched with
+// face turns on axis (0..2, face % 3) excluded; returns that axis as seen from rep. Pass axis -1 to
+// ignore it.
+int symmetryClass(const CubeState& s, int axis, CubeState& rep);
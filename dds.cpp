@@ -0,0 +1,93 @@
+#include "dds.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t MAGIC = 0x20534444;        // "DDS "
+const uint32_t FOURCC_DX10 = 0x30315844;  // "DX10"
+const uint32_t FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+const uint32_t PF_FOURCC = 0x4;
+const uint32_t CAPS_COMPLEX = 0x8, CAPS_TEXTURE = 0x1000, CAPS_MIPMAP = 0x400000;
+const uint32_t CAPS2_CUBEMAP_ALL_FACES = 0x200 | 0xFC00;
+const uint32_t DIMENSION_TEXTURE2D = 3, MISC_TEXTURECUBE = 0x4;
+
+struct PixelFormat { uint32_t size, flags, fourCC, rgbBitCount, masks[4]; };
+struct Header {
+    uint32_t magic, size, flags, height, width, pitchOrLinearSize, depth, mipMapCount, reserved1[11];
+    PixelFormat pixelFormat;
+    uint32_t caps, caps2, caps3, caps4, reserved2;
+    uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2; // DDS_HEADER_DXT10
+};
+static_assert(sizeof(Header) == 4 + 124 + 20, "DDS header layout");
+
+bool knownFormat(uint32_t f) { return f == DDS_BC1_UNORM || f == DDS_BC1_SRGB || f == DDS_BC3_UNORM || f == DDS_BC3_SRGB; }
+
+} // namespace
+
+bool DdsFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) { ::close(fd); return false; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    base = static_cast<uint8_t*>(p); length = (size_t)st.st_size;
+
+    Header h; std::memcpy(&h, base, sizeof(h));
+    bool cube = (h.miscFlag & MISC_TEXTURECUBE) != 0;
+    bool ok = h.magic == MAGIC && h.size == 124 && (h.pixelFormat.flags & PF_FOURCC) && h.pixelFormat.fourCC == FOURCC_DX10 &&
+              knownFormat(h.dxgiFormat) && h.resourceDimension == DIMENSION_TEXTURE2D && h.arraySize == 1 &&
+              h.width > 0 && h.height > 0 && h.mipMapCount > 0 && h.mipMapCount <= 32;
+    if (ok) {
+        format = h.dxgiFormat; width = (int)h.width; height = (int)h.height; mipCount = (int)h.mipMapCount; faceCount = cube ? 6 : 1;
+        size_t offset = sizeof(Header);
+        for (int f = 0; f < faceCount; f++) for (int m = 0; m < mipCount; m++) {
+            offsets.push_back(offset);
+            offset += levelSize(format, std::max(1, width >> m), std::max(1, height >> m));
+        }
+        ok = offset <= length;
+    }
+    if (!ok) close();
+    return ok;
+}
+
+void DdsFile::close() {
+    if (base) munmap(base, length);
+    base = nullptr; length = 0; offsets.clear();
+    format = 0; width = height = mipCount = faceCount = 0;
+}
+
+DdsLevel DdsFile::level(int face, int mip) const {
+    int w = std::max(1, width >> mip), h = std::max(1, height >> mip);
+    return { base + offsets[face * mipCount + mip], levelSize(format, w, h), w, h };
+}
+
+bool DdsFile::write(const std::string& path, uint32_t format, int width, int height, int mipCount, int faceCount, const std::vector<uint8_t>& data) {
+    Header h; std::memset(&h, 0, sizeof(h));
+    h.magic = MAGIC; h.size = 124; h.flags = FLAGS;
+    h.height = (uint32_t)height; h.width = (uint32_t)width; h.pitchOrLinearSize = (uint32_t)levelSize(format, width, height);
+    h.mipMapCount = (uint32_t)mipCount;
+    h.pixelFormat.size = sizeof(PixelFormat); h.pixelFormat.flags = PF_FOURCC; h.pixelFormat.fourCC = FOURCC_DX10;
+    h.caps = CAPS_TEXTURE | CAPS_MIPMAP | CAPS_COMPLEX;
+    h.caps2 = faceCount == 6 ? CAPS2_CUBEMAP_ALL_FACES : 0;
+    h.dxgiFormat = format; h.resourceDimension = DIMENSION_TEXTURE2D; h.miscFlag = faceCount == 6 ? MISC_TEXTURECUBE : 0; h.arraySize = 1;
+
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 && std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (ok) ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) std::remove(tmp.c_str());
+    return ok;
+}
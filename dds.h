@@ -0,0 +1,38 @@
+#pragma once
+// DDS files with the DX10 header holding block-compressed textures and their whole mip chain.
+// rubik_texbake writes them; the game maps them and hands each level to glCompressedTexImage2D.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// DXGI_FORMAT values of the block formats the baker produces
+enum DdsFormat { DDS_BC1_UNORM = 71, DDS_BC1_SRGB = 72, DDS_BC3_UNORM = 77, DDS_BC3_SRGB = 78 };
+
+struct DdsLevel { const uint8_t* data; size_t size; int width, height; };
+
+class DdsFile {
+public:
+    DdsFile() : format(0), width(0), height(0), mipCount(0), faceCount(0), base(nullptr), length(0) {}
+    ~DdsFile() { close(); }
+    DdsFile(const DdsFile&) = delete;
+    DdsFile& operator=(const DdsFile&) = delete;
+
+    // Maps path read-only and checks the header and that every level lies inside the file
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    uint32_t format; int width, height, mipCount;
+    int faceCount; // 6 for a cubemap, faces in GL order +X -X +Y -Y +Z -Z
+    DdsLevel level(int face, int mip) const;
+
+    static size_t blockBytes(uint32_t format) { return (format == DDS_BC1_UNORM || format == DDS_BC1_SRGB) ? 8 : 16; }
+    static size_t levelSize(uint32_t format, int w, int h) { return (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes(format); }
+    // data holds every level, face by face and largest mip first, as level() reads them back
+    static bool write(const std::string& path, uint32_t format, int width, int height, int mipCount, int faceCount, const std::vector<uint8_t>& data);
+
+private:
+    uint8_t* base; size_t length;
+    std::vector<size_t> offsets; // of each (face, mip), face-major
+};
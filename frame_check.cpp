@@ -0,0 +1,50 @@
+// Encoder checks, GL-free: a 2x2 frame of each pure color through FrameWriter's Y4M path, compared
+// with the full-range BT.601 (JFIF) YCbCr of that color rounded and clamped, within one step for the
+// fixed-point arithmetic. Exits nonzero on a mismatch.
+#include "frame_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+int expected(double v) { return (int)std::min(std::max(std::floor(v + 0.5), 0.0), 255.0); }
+
+} // namespace
+
+int main() {
+    const char* PATH = "frame_check.y4m";
+    struct Color { const char* name; int r, g, b; };
+    const Color colors[] = { { "red", 255, 0, 0 }, { "green", 0, 255, 0 }, { "blue", 0, 0, 255 }, { "white", 255, 255, 255 }, { "black", 0, 0, 0 } };
+    int failures = 0;
+    for (const Color& c : colors) {
+        std::vector<uint8_t> rgba;
+        for (int i = 0; i < 4; i++) { rgba.push_back((uint8_t)c.r); rgba.push_back((uint8_t)c.g); rgba.push_back((uint8_t)c.b); rgba.push_back(255); }
+        FrameWriter writer;
+        if (!writer.open(PATH, FrameWriter::FORMAT_Y4M, 2, 2, 30) || !writer.write(rgba.data()) || !writer.close()) { std::cerr << "Could not write " << PATH << std::endl; return 1; }
+
+        std::vector<uint8_t> file;
+        if (FILE* f = std::fopen(PATH, "rb")) {
+            for (int ch; (ch = std::fgetc(f)) != EOF;) file.push_back((uint8_t)ch);
+            std::fclose(f);
+        }
+        std::remove(PATH);
+        const size_t PLANES = 6; // Y for 4 pixels, then one Cb and one Cr
+        if (file.size() < PLANES) { std::cerr << c.name << ": short file" << std::endl; failures++; continue; }
+        const uint8_t* frame = &file[file.size() - PLANES];
+        int want[3] = { expected(0.299 * c.r + 0.587 * c.g + 0.114 * c.b),
+                        expected(128 - 0.168736 * c.r - 0.331264 * c.g + 0.5 * c.b),
+                        expected(128 + 0.5 * c.r - 0.418688 * c.g - 0.081312 * c.b) };
+        int got[3] = { frame[0], frame[4], frame[5] };
+        bool ok = std::all_of(frame, frame + 4, [&](uint8_t y) { return y == frame[0]; });
+        for (int k = 0; k < 3; k++) ok = ok && std::abs(got[k] - want[k]) <= 1;
+        std::cout << (ok ? "ok   " : "FAIL ") << c.name << ": Y Cb Cr " << got[0] << " " << got[1] << " " << got[2]
+                  << " (expected " << want[0] << " " << want[1] << " " << want[2] << ")" << std::endl;
+        failures += !ok;
+    }
+    return failures ? 1 : 0;
+}
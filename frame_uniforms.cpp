@@ -0,0 +1,50 @@
+#include "frame_uniforms.h"
+
+#include <cstring>
+
+void FrameUniforms::init() {
+    GLint align = 256; glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    stride = ((GLsizeiptr)sizeof(FrameData) + align - 1) / align * align;
+    const GLsizeiptr size = stride * RING_SLOTS;
+    glGenBuffers(1, &ubo); glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    if (GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT; // coherent: no flushes
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+        if (!mapped) { glDeleteBuffers(1, &ubo); glGenBuffers(1, &ubo); glBindBuffer(GL_UNIFORM_BUFFER, ubo); } // storage is immutable
+    }
+    if (!mapped) glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::write(const FrameData& data) {
+    if (!ubo) return;
+    if (!fences[slot]) endFrame(); // written twice in one frame (picking): the draws so far read the old slot
+    slot = (slot + 1) % RING_SLOTS;
+    if (fences[slot]) {
+        // Only blocks when the GPU is more than two frames behind
+        while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fences[slot]); fences[slot] = 0;
+    }
+    const GLintptr offset = slot * stride;
+    if (mapped) std::memcpy(mapped + offset, &data, sizeof(data));
+    else {
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        void* dst = glMapBufferRange(GL_UNIFORM_BUFFER, offset, sizeof(data), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (dst) { std::memcpy(dst, &data, sizeof(data)); glUnmapBuffer(GL_UNIFORM_BUFFER); }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, ubo, offset, sizeof(data));
+}
+
+void FrameUniforms::endFrame() {
+    if (!ubo || fences[slot]) return;
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FrameUniforms::release() {
+    for (GLsync& f : fences) { if (f) glDeleteSync(f); f = 0; }
+    if (mapped) { glBindBuffer(GL_UNIFORM_BUFFER, ubo); glUnmapBuffer(GL_UNIFORM_BUFFER); glBindBuffer(GL_UNIFORM_BUFFER, 0); }
+    if (ubo) glDeleteBuffers(1, &ubo);
+    ubo = 0; mapped = nullptr;
+}
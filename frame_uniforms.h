@@ -0,0 +1,38 @@
+#pragma once
+// Per-frame camera data in one std140 uniform block ("Frame") that every program declares, written
+// once per frame instead of as separate view/projection/camPos uniforms per program. The buffer is a
+// ring of three slots so the CPU never overwrites a slot the GPU may still be reading; each slot is
+// reused only after the fence endFrame() placed behind its frame has signalled.
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Uniform buffer binding point of the Frame block; Shader hooks every program with the block up to it
+const GLuint FRAME_BLOCK_BINDING = 0;
+
+// Matches the shaders' block member for member under std140 (mat4 columns and vec4s are 16-byte aligned)
+struct FrameData { glm::mat4 view, projection; glm::vec4 camPos; };
+
+class FrameUniforms {
+public:
+    static const int RING_SLOTS = 3;
+
+    FrameUniforms() : ubo(0), stride(0), mapped(nullptr), slot(0), fences{} {}
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    // GL: one persistently mapped buffer with ARB_buffer_storage, else a plain buffer mapped
+    // unsynchronized per write (the fences keep that safe as well)
+    void init();
+    bool persistent() const { return mapped != nullptr; }
+    // GL: copies data into the next slot and binds it at FRAME_BLOCK_BINDING for the draws that follow
+    void write(const FrameData& data);
+    // GL: after the frame's last draw; fences the slot written for it
+    void endFrame();
+    void release();
+
+private:
+    GLuint ubo; GLsizeiptr stride; // slot size rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    char* mapped; // whole ring when persistently mapped, else null
+    int slot; // last slot written
+    GLsync fences[RING_SLOTS]; // behind the last draws reading each slot, 0 if none pending
+};
@@ -0,0 +1,183 @@
+#include "frame_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    if (!table[1]) for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+    for (int s = 24; s >= 0; s -= 8) out.push_back((uint8_t)(v >> s));
+}
+
+// Length, type, data and the CRC of type and data, around data already at out[start..]
+void closeChunk(std::vector<uint8_t>& out, size_t start) {
+    uint32_t length = (uint32_t)(out.size() - start - 8);
+    for (int k = 0; k < 4; k++) out[start + k] = (uint8_t)(length >> (24 - 8 * k));
+    putBigEndian(out, crc32(&out[start + 4], length + 4));
+}
+
+size_t openChunk(std::vector<uint8_t>& out, const char* type) {
+    size_t start = out.size();
+    out.resize(start + 4); // length, filled in by closeChunk()
+    out.insert(out.end(), type, type + 4);
+    return start;
+}
+
+// Full saturation lands one past the range: pure blue's Cb and pure red's Cr come out as 256
+uint8_t clampByte(int v) { return (uint8_t)std::min(std::max(v, 0), 255); }
+
+// True if pattern has nothing for printf to expand but, at most, one %d, %i or %u with flags and width
+bool frameNumberPattern(const std::string& pattern) {
+    int conversions = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i] != '%') continue;
+        if (++i < pattern.size() && pattern[i] == '%') continue;
+        while (i < pattern.size() && std::strchr("0123456789-+ #", pattern[i])) i++;
+        if (i == pattern.size() || !std::strchr("diu", pattern[i]) || ++conversions > 1) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+FrameWriter::Format FrameWriter::formatFor(const std::string& path) {
+    auto endsWith = [&](const char* ext) { size_t n = std::strlen(ext); return path.size() >= n && path.compare(path.size() - n, n, ext) == 0; };
+    if (endsWith(".png")) return FORMAT_PNG;
+    if (endsWith(".rgb")) return FORMAT_RAW;
+    return FORMAT_Y4M;
+}
+
+bool FrameWriter::open(const std::string& p, Format f, int w, int h, int fps) {
+    close();
+    path = p; format = f; width = w; height = h; frame = 0; failed = false;
+    if (format == FORMAT_Y4M && (width % 2 || height % 2)) { std::cerr << "Y4M (4:2:0) needs an even width and height" << std::endl; return false; }
+    if (format == FORMAT_PNG) {
+        if (!frameNumberPattern(path)) { std::cerr << "PNG path takes at most one integer conversion for the frame number, like frame_%04d.png: " << path << std::endl; return false; }
+        return true;
+    }
+    file = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+    if (!file) { std::cerr << "Could not write " << path << std::endl; return false; }
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    if (format == FORMAT_Y4M) std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+    return true;
+}
+
+bool FrameWriter::write(const uint8_t* rgba) {
+    if (failed) return false;
+    if (format == FORMAT_PNG) failed = !writePng(rgba);
+    else if (!file) failed = true;
+    else {
+        if (format == FORMAT_Y4M) encodeY4m(rgba);
+        else {
+            out.resize((size_t)width * height * 3);
+            uint8_t* dst = out.data();
+            for (int y = height - 1; y >= 0; y--) {
+                const uint8_t* src = rgba + (size_t)y * width * 4;
+                for (int x = 0; x < width; x++, src += 4, dst += 3) { dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; }
+            }
+        }
+        failed = std::fwrite(out.data(), 1, out.size(), file) != out.size();
+    }
+    if (!failed) frame++;
+    return !failed;
+}
+
+// FRAME, then the Y plane and the 2x2-averaged Cb and Cr planes (JFIF coefficients in 8.8 fixed point)
+void FrameWriter::encodeY4m(const uint8_t* rgba) {
+    static const char HEADER[] = "FRAME\n";
+    const size_t header = sizeof(HEADER) - 1, luma = (size_t)width * height, chroma = luma / 4;
+    out.resize(header + luma + 2 * chroma);
+    std::memcpy(out.data(), HEADER, header);
+    uint8_t* yPlane = out.data() + header; uint8_t* cbPlane = yPlane + luma; uint8_t* crPlane = cbPlane + chroma;
+    const size_t stride = (size_t)width * 4;
+    for (int y = 0; y < height; y += 2) {
+        const uint8_t* top = rgba + (size_t)(height - 1 - y) * stride; // output row y is GL row height-1-y
+        const uint8_t* bottom = top - stride;
+        uint8_t* yTop = yPlane + (size_t)y * width; uint8_t* yBottom = yTop + width;
+        uint8_t* cb = cbPlane + (size_t)(y / 2) * (width / 2); uint8_t* cr = crPlane + (size_t)(y / 2) * (width / 2);
+        for (int x = 0; x < width; x += 2, top += 8, bottom += 8) {
+            int r = 0, g = 0, b = 0;
+            const uint8_t* quad[4] = { top, top + 4, bottom, bottom + 4 };
+            uint8_t* lumaOut[4] = { yTop + x, yTop + x + 1, yBottom + x, yBottom + x + 1 };
+            for (int k = 0; k < 4; k++) {
+                const uint8_t* px = quad[k];
+                *lumaOut[k] = (uint8_t)((77 * px[0] + 150 * px[1] + 29 * px[2] + 128) >> 8);
+                r += px[0]; g += px[1]; b += px[2];
+            }
+            cb[x / 2] = clampByte(128 + ((-43 * r - 85 * g + 128 * b + 512) >> 10));
+            cr[x / 2] = clampByte(128 + ((128 * r - 107 * g - 21 * b + 512) >> 10));
+        }
+    }
+}
+
+// 8-bit RGB, unfiltered, in stored (uncompressed) deflate blocks: no zlib needed, and no time spent
+// compressing; run the files through any PNG optimizer when their size matters
+bool FrameWriter::writePng(const uint8_t* rgba) {
+    const size_t rowBytes = (size_t)width * 3 + 1;
+    rows.resize(rowBytes * height);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = rgba + (size_t)(height - 1 - y) * width * 4;
+        uint8_t* dst = &rows[(size_t)y * rowBytes];
+        *dst++ = 0; // filter type None
+        for (int x = 0; x < width; x++, src += 4, dst += 3) { dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; }
+    }
+    uint32_t a = 1, b = 0; // Adler-32, reduced every 5552 bytes (the most that can't overflow)
+    for (size_t i = 0; i < rows.size();) {
+        for (size_t end = std::min(rows.size(), i + 5552); i < end; i++) { a += rows[i]; b += a; }
+        a %= 65521; b %= 65521;
+    }
+
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const size_t BLOCK = 65535; // largest stored block
+    out.clear();
+    out.reserve(rows.size() + rows.size() / BLOCK * 5 + 64);
+    out.insert(out.end(), SIGNATURE, SIGNATURE + 8);
+    size_t chunk = openChunk(out, "IHDR");
+    putBigEndian(out, (uint32_t)width); putBigEndian(out, (uint32_t)height);
+    const uint8_t ihdr[5] = { 8, 2, 0, 0, 0 }; // 8 bits, RGB, deflate, adaptive filtering, no interlace
+    out.insert(out.end(), ihdr, ihdr + 5);
+    closeChunk(out, chunk);
+    chunk = openChunk(out, "IDAT");
+    out.push_back(0x78); out.push_back(0x01); // zlib header: deflate, 32K window, no dictionary
+    for (size_t i = 0; i < rows.size(); i += BLOCK) {
+        size_t len = std::min(BLOCK, rows.size() - i);
+        out.push_back(i + len == rows.size() ? 1 : 0); // BFINAL on the last block, BTYPE 00 (stored)
+        out.push_back((uint8_t)len); out.push_back((uint8_t)(len >> 8));
+        out.push_back((uint8_t)~len); out.push_back((uint8_t)(~len >> 8));
+        out.insert(out.end(), rows.begin() + i, rows.begin() + i + len);
+    }
+    putBigEndian(out, (b << 16) | a);
+    closeChunk(out, chunk);
+    closeChunk(out, openChunk(out, "IEND"));
+
+    char name[4096];
+    std::snprintf(name, sizeof(name), path.c_str(), frame);
+    FILE* f = std::fopen(name, "wb");
+    if (!f) { std::cerr << "Could not write " << name << std::endl; return false; }
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) std::cerr << "Could not write " << name << std::endl;
+    return ok;
+}
+
+bool FrameWriter::close() {
+    if (file) {
+        failed = std::fflush(file) != 0 || failed;
+        if (file != stdout) failed = std::fclose(file) != 0 || failed;
+        file = nullptr;
+    }
+    return !failed;
+}
@@ -0,0 +1,40 @@
+#pragma once
+// Encodes rendered frames for export, GL-free. Frames come in as glReadPixels leaves them (RGBA8,
+// bottom row first) and go out top row first as one of:
+//   FORMAT_Y4M  YUV4MPEG2 4:2:0 (full-range BT.601) stream, what ffmpeg and most encoders read from a pipe
+//   FORMAT_RAW  headerless RGB24 stream (ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH)
+//   FORMAT_PNG  one PNG file per frame, path being a printf pattern for the frame number (frame_%04d.png)
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class FrameWriter {
+public:
+    enum Format { FORMAT_Y4M, FORMAT_RAW, FORMAT_PNG };
+
+    FrameWriter() : format(FORMAT_Y4M), width(0), height(0), frame(0), failed(false), file(nullptr) {}
+    ~FrameWriter() { close(); }
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // By path's extension: .png and .rgb as named, anything else (and "-") Y4M
+    static Format formatFor(const std::string& path);
+
+    // "-" streams to stdout. Y4M needs an even width and height. False, with the reason on std::cerr,
+    // if the stream can't be opened or the size doesn't suit the format.
+    bool open(const std::string& path, Format format, int width, int height, int fps);
+    bool write(const uint8_t* rgba);
+    // False if anything failed to write, e.g. the reading end of the pipe went away
+    bool close();
+    int frames() const { return frame; }
+
+private:
+    Format format; std::string path;
+    int width, height, frame; bool failed;
+    FILE* file; // the stream, or null for PNG files
+    std::vector<uint8_t> out, rows; // one encoded frame; a PNG's scanlines before deflating
+
+    bool writePng(const uint8_t* rgba);
+    void encodeY4m(const uint8_t* rgba);
+};
@@ -0,0 +1,350 @@
+#include "ibl.h"
+#include "table_cache.h"
+#include "texture_stream.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+const float PI = 3.14159265358979f;
+const int PREFILTER_SAMPLES = 128, BRDF_SAMPLES = 256;
+const int SH_SOURCE_SIZE = 32; // SH projection reads the first source mip at most this large
+// Real SH basis constants for bands 0-2, in the order of the polynomial in ibl.h
+const float SH_K[9] = { 0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f };
+enum { SECTION_SPECULAR = 0, SECTION_IRRADIANCE = Ibl::SPECULAR_LEVELS, SECTION_BRDF, SECTION_COUNT };
+
+// One cubemap mip level in linear rgb, faces in GL order, rows top to bottom as stored in the images
+struct CubeLevel { int size; std::vector<float> texels; };
+
+size_t specularBytes(int level) { size_t s = Ibl::SPECULAR_SIZE >> level; return 6 * s * s * 3 * sizeof(float); }
+
+float srgbToLinear(unsigned char c) { float v = c / 255.0f; return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f); }
+
+// Direction through (u, v) in [-1, 1] on face, following the GL cubemap face orientation
+glm::vec3 faceDirection(int face, float u, float v) {
+    switch (face) {
+        case 0: return glm::vec3(1, -v, -u);
+        case 1: return glm::vec3(-1, -v, u);
+        case 2: return glm::vec3(u, 1, v);
+        case 3: return glm::vec3(u, -1, -v);
+        case 4: return glm::vec3(u, -v, 1);
+        default: return glm::vec3(-u, -v, -1);
+    }
+}
+
+void faceCoords(const glm::vec3& d, int& face, float& u, float& v) {
+    glm::vec3 a = glm::abs(d);
+    if (a.x >= a.y && a.x >= a.z) { face = d.x > 0 ? 0 : 1; u = (d.x > 0 ? -d.z : d.z) / a.x; v = -d.y / a.x; }
+    else if (a.y >= a.z) { face = d.y > 0 ? 2 : 3; u = d.x / a.y; v = (d.y > 0 ? d.z : -d.z) / a.y; }
+    else { face = d.z > 0 ? 4 : 5; u = (d.z > 0 ? d.x : -d.x) / a.z; v = -d.y / a.z; }
+}
+
+glm::vec3 texel(const CubeLevel& l, int face, int x, int y) {
+    const float* p = &l.texels[((size_t)(face * l.size + y) * l.size + x) * 3];
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+// Bilinear within one face; edges clamp instead of crossing to the neighbour face
+glm::vec3 sampleLevel(const CubeLevel& l, const glm::vec3& d) {
+    int face; float u, v; faceCoords(d, face, u, v);
+    float x = std::min(std::max((u + 1) * 0.5f * l.size - 0.5f, 0.0f), l.size - 1.0f);
+    float y = std::min(std::max((v + 1) * 0.5f * l.size - 0.5f, 0.0f), l.size - 1.0f);
+    int x0 = (int)x, y0 = (int)y, x1 = std::min(x0 + 1, l.size - 1), y1 = std::min(y0 + 1, l.size - 1);
+    float fx = x - x0, fy = y - y0;
+    return glm::mix(glm::mix(texel(l, face, x0, y0), texel(l, face, x1, y0), fx), glm::mix(texel(l, face, x0, y1), texel(l, face, x1, y1), fx), fy);
+}
+
+glm::vec3 sampleLod(const std::vector<CubeLevel>& mips, const glm::vec3& d, float lod) {
+    lod = std::min(std::max(lod, 0.0f), (float)mips.size() - 1);
+    int l0 = (int)lod, l1 = std::min(l0 + 1, (int)mips.size() - 1);
+    return glm::mix(sampleLevel(mips[l0], d), sampleLevel(mips[l1], d), lod - l0);
+}
+
+void buildMips(std::vector<CubeLevel>& mips) {
+    while (mips.back().size > 1) {
+        const CubeLevel& src = mips.back();
+        CubeLevel dst; dst.size = src.size / 2; dst.texels.resize((size_t)6 * dst.size * dst.size * 3);
+        for (int f = 0; f < 6; f++) for (int y = 0; y < dst.size; y++) for (int x = 0; x < dst.size; x++) {
+            glm::vec3 c = (texel(src, f, 2 * x, 2 * y) + texel(src, f, 2 * x + 1, 2 * y) + texel(src, f, 2 * x, 2 * y + 1) + texel(src, f, 2 * x + 1, 2 * y + 1)) * 0.25f;
+            float* p = &dst.texels[((size_t)(f * dst.size + y) * dst.size + x) * 3];
+            p[0] = c.x; p[1] = c.y; p[2] = c.z;
+        }
+        mips.push_back(std::move(dst));
+    }
+}
+
+glm::vec2 hammersley(int i, int n) {
+    uint32_t b = (uint32_t)i;
+    b = (b << 16) | (b >> 16); b = ((b & 0x55555555u) << 1) | ((b & 0xAAAAAAAAu) >> 1); b = ((b & 0x33333333u) << 2) | ((b & 0xCCCCCCCCu) >> 2);
+    b = ((b & 0x0F0F0F0Fu) << 4) | ((b & 0xF0F0F0F0u) >> 4); b = ((b & 0x00FF00FFu) << 8) | ((b & 0xFF00FF00u) >> 8);
+    return glm::vec2((float)i / n, b * 2.3283064365386963e-10f);
+}
+
+// GGX-distributed half vector around +Z for alpha = roughness^2
+glm::vec3 sampleGgx(const glm::vec2& xi, float alpha) {
+    float phi = 2 * PI * xi.x, cosTheta = std::sqrt((1 - xi.y) / (1 + (alpha * alpha - 1) * xi.y)), sinTheta = std::sqrt(1 - cosTheta * cosTheta);
+    return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+}
+
+float ggx(float nh, float alpha) { float a2 = alpha * alpha, d = nh * nh * (a2 - 1) + 1; return a2 / (PI * d * d); }
+
+// Split-sum prefilter with N = V = R. Each sample reads the source mip whose texels cover about
+// the sample's solid angle, so few samples suffice without fireflies from bright texels.
+// With N = V the light directions, weights and mips are the same around every N, so they are
+// computed once per level in tangent space.
+void prefilter(const std::vector<CubeLevel>& src, int level, std::vector<float>& out) {
+    int size = Ibl::SPECULAR_SIZE >> level;
+    float roughness = (float)level / (Ibl::SPECULAR_LEVELS - 1), alpha = roughness * roughness;
+    float texelSolidAngle = 4 * PI / (6.0f * src[0].size * src[0].size);
+    struct Tap { glm::vec3 l; float weight, lod; };
+    std::vector<Tap> taps;
+    float weight = 0;
+    for (int i = 0; level > 0 && i < PREFILTER_SAMPLES; i++) {
+        glm::vec3 h = sampleGgx(hammersley(i, PREFILTER_SAMPLES), alpha), l = 2 * h.z * h - glm::vec3(0, 0, 1);
+        if (l.z <= 0) continue;
+        float sampleSolidAngle = 1 / (PREFILTER_SAMPLES * ggx(h.z, alpha) / 4 + 1e-4f);
+        taps.push_back({ l, l.z, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1 });
+        weight += l.z;
+    }
+    out.resize(specularBytes(level) / sizeof(float));
+    sharedThreadPool().parallelFor((size_t)6 * size, 4, [&](size_t begin, size_t end, int) {
+        for (size_t row = begin; row < end; row++) {
+            int face = (int)row / size, y = (int)row % size;
+            for (int x = 0; x < size; x++) {
+                glm::vec3 n = glm::normalize(faceDirection(face, (x + 0.5f) / size * 2 - 1, (y + 0.5f) / size * 2 - 1)), color(0.0f);
+                if (level == 0) color = sampleLod(src, n, std::log2((float)src[0].size / size));
+                else {
+                    glm::vec3 up = std::fabs(n.z) < 0.999f ? glm::vec3(0, 0, 1) : glm::vec3(1, 0, 0);
+                    glm::vec3 tx = glm::normalize(glm::cross(up, n)), ty = glm::cross(n, tx);
+                    for (const Tap& t : taps) color += sampleLod(src, tx * t.l.x + ty * t.l.y + n * t.l.z, t.lod) * t.weight;
+                    color = color * (1 / std::max(weight, 1e-4f));
+                }
+                float* p = &out[((size_t)row * size + x) * 3];
+                p[0] = color.x; p[1] = color.y; p[2] = color.z;
+            }
+        }
+    });
+}
+
+void projectIrradiance(const std::vector<CubeLevel>& src, float* out) {
+    size_t level = 0;
+    while (level + 1 < src.size() && src[level].size > SH_SOURCE_SIZE) level++;
+    const CubeLevel& l = src[level];
+    glm::vec3 sh[9]; std::fill(sh, sh + 9, glm::vec3(0.0f));
+    for (int f = 0; f < 6; f++) for (int y = 0; y < l.size; y++) for (int x = 0; x < l.size; x++) {
+        float u = (x + 0.5f) / l.size * 2 - 1, v = (y + 0.5f) / l.size * 2 - 1;
+        float solidAngle = 4.0f / (l.size * l.size * std::pow(1 + u * u + v * v, 1.5f));
+        glm::vec3 d = glm::normalize(faceDirection(f, u, v)), c = texel(l, f, x, y) * solidAngle;
+        float basis[9] = { 1, d.y, d.z, d.x, d.x * d.y, d.y * d.z, 3 * d.z * d.z - 1, d.x * d.z, d.x * d.x - d.y * d.y };
+        for (int i = 0; i < 9; i++) sh[i] += c * (SH_K[i] * basis[i]);
+    }
+    // Cosine lobe convolution per band (pi, 2pi/3, pi/4) and the basis constant again for evaluation, over pi
+    static const float A[9] = { PI, 2 * PI / 3, 2 * PI / 3, 2 * PI / 3, PI / 4, PI / 4, PI / 4, PI / 4, PI / 4 };
+    for (int i = 0; i < 9; i++) { glm::vec3 c = sh[i] * (SH_K[i] * A[i] / PI); out[i * 3] = c.x; out[i * 3 + 1] = c.y; out[i * 3 + 2] = c.z; }
+}
+
+// Scale and bias to F0 of the specular integral over the hemisphere, for t = (N.V, roughness)
+void integrateBrdf(std::vector<float>& out) {
+    const int n = Ibl::BRDF_SIZE;
+    out.resize((size_t)n * n * 2);
+    for (int y = 0; y < n; y++) for (int x = 0; x < n; x++) {
+        float nv = (x + 0.5f) / n, roughness = (y + 0.5f) / n, alpha = roughness * roughness, k = alpha / 2;
+        glm::vec3 v(std::sqrt(1 - nv * nv), 0, nv);
+        float a = 0, b = 0;
+        for (int i = 0; i < BRDF_SAMPLES; i++) {
+            glm::vec3 h = sampleGgx(hammersley(i, BRDF_SAMPLES), alpha), l = 2 * glm::dot(v, h) * h - v;
+            float nl = std::max(l.z, 0.0f), nh = std::max(h.z, 0.0f), vh = std::max(glm::dot(v, h), 0.0f);
+            if (nl <= 0) continue;
+            float g = (nv / (nv * (1 - k) + k)) * (nl / (nl * (1 - k) + k));
+            float gVis = g * vh / (nh * nv), fc = std::pow(1 - vh, 5.0f);
+            a += (1 - fc) * gVis; b += fc * gVis;
+        }
+        out[((size_t)y * n + x) * 2] = a / BRDF_SAMPLES; out[((size_t)y * n + x) * 2 + 1] = b / BRDF_SAMPLES;
+    }
+}
+
+// A face as TextureStream decoded it: 8-bit, channels per pixel (gray ones take the first)
+struct FaceImage { const unsigned char* pixels; int width, height, channels; };
+
+// The six faces as mip 0; false if any is missing or they differ in size
+bool linearFaces(const std::vector<FaceImage>& faces, CubeLevel& out) {
+    float linear[256]; for (int i = 0; i < 256; i++) linear[i] = srgbToLinear((unsigned char)i);
+    out.size = 0;
+    for (size_t f = 0; f < faces.size(); f++) {
+        const FaceImage& img = faces[f];
+        const int w = img.width;
+        if (!img.pixels || w != img.height || (f > 0 && w != out.size)) return false;
+        if (f == 0) { out.size = w; out.texels.resize((size_t)6 * w * w * 3); }
+        float* dst = &out.texels[f * w * w * 3];
+        for (size_t i = 0; i < (size_t)w * w; i++) for (int c = 0; c < 3; c++) dst[i * 3 + c] = linear[img.pixels[i * img.channels + (img.channels >= 3 ? c : 0)]];
+    }
+    return faces.size() == 6;
+}
+
+// What the cube is lit by until the bake is in, or for good if the faces can't be read: the gray
+// of loadCubemap's placeholder, which prefiltering leaves as it is
+void flatEnvironment(std::vector<float> (&specular)[Ibl::SPECULAR_LEVELS], float* irradiance) {
+    std::vector<CubeLevel> mips(1);
+    mips[0].size = 1; mips[0].texels.assign(6 * 3, srgbToLinear(50));
+    for (int l = 0; l < Ibl::SPECULAR_LEVELS; l++) specular[l].assign(specularBytes(l) / sizeof(float), mips[0].texels[0]);
+    projectIrradiance(mips, irradiance);
+}
+
+// Path, size and modification time of each face: enough to notice a changed skybox without reading
+// it. False if a face is missing.
+bool facesFingerprint(const std::vector<std::string>& faces, uint64_t& out) {
+    std::string key;
+    bool found = true;
+    for (const std::string& f : faces) {
+        struct stat st;
+        char entry[64] = "missing";
+        if (stat(f.c_str(), &st) == 0) std::snprintf(entry, sizeof(entry), "%lld %lld.%09ld", (long long)st.st_size, (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+        else found = false;
+        key += f; key += '\0'; key += entry; key += '\0';
+    }
+    out = TableCache::checksum(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+    return found;
+}
+
+} // namespace
+
+struct Ibl::Bake {
+    std::vector<FaceImage> faces;
+    std::vector<float> specular[SPECULAR_LEVELS], brdf;
+    float irradiance[9 * 3];
+    bool ok;
+    std::atomic<bool> done;
+
+    Bake() : ok(false), done(false) {}
+    void run() {
+        std::vector<CubeLevel> mips(1);
+        ok = linearFaces(faces, mips[0]);
+        if (ok) {
+            buildMips(mips);
+            for (int l = 0; l < SPECULAR_LEVELS; l++) prefilter(mips, l, specular[l]);
+            projectIrradiance(mips, irradiance);
+        }
+        done = true;
+    }
+};
+
+Ibl::Ibl() : specularMap(0), brdfLut(0), baked(false), seconds(0), stream(nullptr), fingerprint(0) {}
+
+Ibl::~Ibl() {
+    if (bakeThread.joinable()) bakeThread.join();
+}
+
+bool Ibl::init(const std::vector<std::string>& faceFiles, TextureStream& textures, const std::string& cacheFile) {
+    start = std::chrono::steady_clock::now();
+    faces = faceFiles; cachePath = cacheFile;
+    bool found = facesFingerprint(faces, fingerprint) && faces.size() == 6;
+
+    TableCache cache;
+    const float* specular[SPECULAR_LEVELS]; const float* brdf = nullptr;
+    bool cached = found && !cachePath.empty() && cache.open(cachePath, IBL_CACHE_VERSION, fingerprint, SECTION_COUNT);
+    for (int id = 0; cached && id < SECTION_COUNT; id++) {
+        size_t size; const uint8_t* p = cache.section(id, size);
+        size_t expected = id < SECTION_IRRADIANCE ? specularBytes(id) : id == SECTION_IRRADIANCE ? sizeof(irradiance) : (size_t)BRDF_SIZE * BRDF_SIZE * 2 * sizeof(float);
+        if (!p || size != expected || !cache.verify(id)) { cached = false; break; }
+        if (id < SECTION_IRRADIANCE) specular[id] = reinterpret_cast<const float*>(p);
+        else if (id == SECTION_IRRADIANCE) std::copy(p, p + size, reinterpret_cast<uint8_t*>(irradiance));
+        else brdf = reinterpret_cast<const float*>(p);
+    }
+    baked = !cached;
+    if (cached) {
+        upload(specular, brdf);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    // Flat until poll() has the bake; the BRDF LUT doesn't depend on the faces and is ready at once
+    cache.close();
+    bake.reset(new Bake());
+    integrateBrdf(bake->brdf);
+    flatEnvironment(bake->specular, irradiance);
+    for (int l = 0; l < SPECULAR_LEVELS; l++) specular[l] = bake->specular[l].data();
+    upload(specular, bake->brdf.data());
+    if (!found) {
+        std::cerr << "IBL: could not read the skybox faces, using a flat environment" << std::endl;
+        bake.reset();
+        return false;
+    }
+    stream = &textures;
+    stream->keep(faces);
+    return true;
+}
+
+bool Ibl::poll() {
+    if (!stream) return false;
+    if (!bakeThread.joinable()) {
+        bake->faces.resize(faces.size());
+        for (size_t f = 0; f < faces.size(); f++) {
+            FaceImage& img = bake->faces[f];
+            if (!stream->pixels(faces[f], img.pixels, img.width, img.height, img.channels)) return false;
+        }
+        bakeThread = std::thread(&Bake::run, bake.get());
+        return false;
+    }
+    if (!bake->done) return false;
+    bakeThread.join();
+    stream->unkeep(faces); stream = nullptr;
+    std::unique_ptr<Bake> done(std::move(bake));
+    if (!done->ok) { std::cerr << "IBL: could not read the skybox faces, using a flat environment" << std::endl; return false; }
+
+    const float* specular[SPECULAR_LEVELS];
+    for (int l = 0; l < SPECULAR_LEVELS; l++) specular[l] = done->specular[l].data();
+    std::copy(done->irradiance, done->irradiance + 9 * 3, irradiance);
+    upload(specular, done->brdf.data());
+    if (!cachePath.empty()) {
+        std::vector<TableSection> sections;
+        for (int l = 0; l < SPECULAR_LEVELS; l++) sections.push_back({ specular[l], specularBytes(l) });
+        sections.push_back({ irradiance, sizeof(irradiance) });
+        sections.push_back({ done->brdf.data(), done->brdf.size() * sizeof(float) });
+        if (!TableCache::write(cachePath, IBL_CACHE_VERSION, fingerprint, sections)) std::cerr << "IBL: could not write " << cachePath << std::endl;
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "IBL: baked environment maps in " << (int)(seconds * 1000) << " ms" << std::endl;
+    return true;
+}
+
+void Ibl::finish() {
+    while (stream) { poll(); if (stream) std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+}
+
+void Ibl::upload(const float* const* specular, const float* brdf) {
+    release();
+    glGenTextures(1, &specularMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, specularMap);
+    for (int l = 0; l < SPECULAR_LEVELS; l++) {
+        int s = SPECULAR_SIZE >> l;
+        for (int f = 0; f < 6; f++) glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, l, GL_RGB16F, s, s, 0, GL_RGB, GL_FLOAT, specular[l] + (size_t)f * s * s * 3);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, SPECULAR_LEVELS - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &brdfLut);
+    glBindTexture(GL_TEXTURE_2D, brdfLut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, BRDF_SIZE, BRDF_SIZE, 0, GL_RG, GL_FLOAT, brdf);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void Ibl::release() {
+    if (specularMap) glDeleteTextures(1, &specularMap);
+    if (brdfLut) glDeleteTextures(1, &brdfLut);
+    specularMap = brdfLut = 0;
+}
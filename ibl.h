@@ -0,0 +1,58 @@
+#pragma once
+// Image-based lighting from the skybox: a GGX-prefiltered specular cubemap, SH9 diffuse irradiance
+// and the split-sum BRDF lookup table. Baked on the CPU once and cached, so later launches only upload.
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TextureStream;
+
+const uint32_t IBL_CACHE_VERSION = 1; // bump when the bake or the section layout changes
+const char* const IBL_CACHE_FILE = "rubik_ibl.bin";
+
+class Ibl {
+public:
+    static const int SPECULAR_SIZE = 128;  // edge of mip 0 (roughness 0); level i has roughness i / (LEVELS - 1)
+    static const int SPECULAR_LEVELS = 5;
+    static const int BRDF_SIZE = 32;       // LUT over (N.V, roughness), RG = scale and bias applied to F0
+
+    Ibl();
+    ~Ibl(); // waits for a bake in progress
+    Ibl(const Ibl&) = delete;
+    Ibl& operator=(const Ibl&) = delete;
+
+    // Needs a current GL context. faces are the skybox images in GL order (+X -X +Y -Y +Z -Z).
+    // Maps cachePath if it matches them (by path, size and modification time: nothing is read).
+    // Otherwise the cube is lit by a flat gray environment, as loadCubemap does, until poll() has
+    // baked the maps from the faces textures decodes anyway and rewritten the cache. Missing faces
+    // keep the flat environment and return false.
+    bool init(const std::vector<std::string>& faces, TextureStream& textures, const std::string& cachePath = IBL_CACHE_FILE);
+    // GL, main thread: starts the bake once the faces have decoded, on a thread of its own, and
+    // uploads the maps when it is done. True if they changed, so the frame needs redrawing.
+    bool poll();
+    bool baking() const { return stream != nullptr; }
+    // Blocks until the pending bake, if any, is uploaded
+    void finish();
+    void release();
+
+    GLuint specularMap, brdfLut;
+    // Irradiance / pi as 9 rgb SH coefficients with the basis constants and cosine lobe folded in,
+    // so the shader evaluates the bare polynomial (1, y, z, x, xy, yz, 3z^2-1, xz, x^2-y^2)
+    float irradiance[9 * 3];
+    bool baked;     // false if the last init() came from the cache
+    double seconds; // from init() to the maps in place, loaded or baked
+
+private:
+    struct Bake; // the maps from the decoded faces, on bakeThread
+    std::unique_ptr<Bake> bake; std::thread bakeThread;
+    TextureStream* stream; // while a bake is pending
+    std::vector<std::string> faces; std::string cachePath; uint64_t fingerprint;
+    std::chrono::steady_clock::time_point start;
+
+    void upload(const float* const* specular, const float* brdf);
+};
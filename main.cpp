@@ -10,15 +10,42 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "bench_report.h"
+#include "cube_nxn.h"
+#include "cube_state.h"
+#include "dds.h"
+#include "frame_writer.h"
+#include "frame_uniforms.h"
+#include "ibl.h"
+#include "offscreen.h"
+#include "profiler.h"
+#include "scramble.h"
+#include "async_solver.h"
+#include "session_log.h"
+#include "solver.h"
+#include "texture_stream.h"
+#include "triple_buffer.h"
+
 #include <vector>
 #include <array>
+#include <bitset>
 #include <string>
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 #include <deque>
+#include <memory>
+#include <unordered_map>
 #include <ctime>
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 const int WINDOW_WIDTH = 1024;
 const int WINDOW_HEIGHT = 768;
@@ -32,23 +59,15 @@ const glm::vec4 GREEN  = {0.0f, 1.0f, 0.0f, 1.0f};
 const glm::vec4 BLUE   = {0.0f, 0.2f, 1.0f, 1.0f};
 const glm::vec4 BLACK_PLASTIC = {0.05f, 0.05f, 0.05f, 1.0f};
 
-enum MoveType { 
-    MOVE_F, MOVE_F_PRIME, MOVE_B, MOVE_B_PRIME, 
-    MOVE_L, MOVE_L_PRIME, MOVE_R, MOVE_R_PRIME, 
-    MOVE_U, MOVE_U_PRIME, MOVE_D, MOVE_D_PRIME, 
-    MOVE_M, MOVE_M_PRIME, MOVE_E, MOVE_E_PRIME, 
-    MOVE_S, MOVE_S_PRIME, MOVE_NONE 
-};
-
-enum FaceDir { POS_X=0, NEG_X, POS_Y, NEG_Y, POS_Z, NEG_Z };
+// U, R, F, D, L, B in the order of cube_state.h's Face
+const glm::vec4 faceColors[6] = { WHITE, GREEN, RED, YELLOW, BLUE, ORANGE };
 
 // --- Shaders ---
 const char* skyboxVS = R"(
     #version 330 core
     layout (location = 0) in vec3 aPos;
     out vec3 TexCoords;
-    uniform mat4 projection;
-    uniform mat4 view;
+    layout (std140) uniform Frame { mat4 view; mat4 projection; vec4 camPos; }; // FrameData
     void main() {
         TexCoords = aPos;
         vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
@@ -72,18 +91,19 @@ const char* cubeVS = R"(
     layout (location = 1) in vec3 aNormal;
     layout (location = 2) in vec2 aTexCoord;
     uniform mat4 model;
-    uniform mat4 view;
-    uniform mat4 projection;
+    uniform mat3 normalMatrix;
+    layout (std140) uniform Frame { mat4 view; mat4 projection; vec4 camPos; }; // FrameData
     out vec3 WorldPos;
     out vec3 Normal;
     out vec2 TexCoord;
     void main() {
         TexCoord = aTexCoord;
         WorldPos = vec3(model * vec4(aPos, 1.0));
-        Normal = mat3(transpose(inverse(model))) * aNormal;   
+        Normal = normalMatrix * aNormal;
         gl_Position = projection * view * vec4(WorldPos, 1.0);
     }
 )";
+// Variants: ROUGHNESS is the face material, USE_LOGO samples the logo (see CubeShaders)
 const char* cubeFS = R"(
     #version 330 core
     out vec4 FragColor;
@@ -92,26 +112,126 @@ const char* cubeFS = R"(
     in vec2 TexCoord;
     uniform vec4 uAlbedoColor;
     uniform sampler2D uLogoTexture;
-    uniform bool uUseLogo;
-    uniform float uRoughness; 
-    uniform vec3 uCamPos;
-    uniform samplerCube uSkybox;
-    float fresnelSchlick(float cosTheta, float F0) { return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0); }
+    layout (std140) uniform Frame { mat4 view; mat4 projection; vec4 camPos; }; // FrameData
+    uniform samplerCube uSpecularMap;
+    uniform sampler2D uBrdfLut;
+    uniform vec3 uIrradianceSH[9];
+    const float SPECULAR_MAX_LOD = 4.0; // Ibl::SPECULAR_LEVELS - 1
+    vec3 irradianceSH(vec3 n) {
+        return uIrradianceSH[0] + uIrradianceSH[1] * n.y + uIrradianceSH[2] * n.z + uIrradianceSH[3] * n.x
+             + uIrradianceSH[4] * (n.x * n.y) + uIrradianceSH[5] * (n.y * n.z) + uIrradianceSH[6] * (3.0 * n.z * n.z - 1.0)
+             + uIrradianceSH[7] * (n.x * n.z) + uIrradianceSH[8] * (n.x * n.x - n.y * n.y);
+    }
     void main() {
         vec3 N = normalize(Normal);
-        vec3 V = normalize(uCamPos - WorldPos);
+        vec3 V = normalize(camPos.xyz - WorldPos);
         vec3 R = reflect(-V, N);
         vec3 albedo = uAlbedoColor.rgb;
-        if (uUseLogo) {
-            vec4 logo = texture(uLogoTexture, TexCoord);
-            albedo = mix(albedo, logo.rgb * albedo, logo.a);
-        }
+    #ifdef USE_LOGO
+        vec4 logo = texture(uLogoTexture, TexCoord);
+        albedo = mix(albedo, logo.rgb * albedo, logo.a);
+    #endif
+        float F0 = 0.04; 
+        vec2 brdf = texture(uBrdfLut, vec2(max(dot(N, V), 0.0), ROUGHNESS)).rg;
+        vec3 prefilteredColor = textureLod(uSpecularMap, R, ROUGHNESS * SPECULAR_MAX_LOD).rgb; 
+        vec3 specular = prefilteredColor * (F0 * brdf.x + brdf.y) * 1.5; 
+        vec3 diffuse = irradianceSH(N) * albedo * 1.2; 
+        vec3 color = diffuse + specular;
+        color = vec3(1.0) - exp(-color * 1.0);
+        color = pow(color, vec3(1.0/2.2));   
+        FragColor = vec4(color, 1.0);
+    }
+)";
+
+// USE_ATLAS draws distance-LOD boxes, whole cubes colored from an atlas of their facelets; aLogoFace
+// then holds the box's atlas row (see CubeRenderer::drawBoxes)
+const char* cubeInstancedVS = R"(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    layout (location = 1) in vec3 aNormal;
+    layout (location = 2) in vec2 aTexCoord;
+    layout (location = 3) in vec4 aModelRow[3];
+    layout (location = 6) in mat3 aNormalMatrix;
+    layout (location = 9) in vec4 aFaceColor[6];
+    layout (location = 15) in float aLogoFace;
+    layout (std140) uniform Frame { mat4 view; mat4 projection; vec4 camPos; }; // FrameData
+    out vec3 WorldPos;
+    out vec3 Normal;
+    out vec2 TexCoord;
+    flat out vec4 Albedo;
+    #ifdef USE_LOGO
+    flat out float LogoMask;
+    #endif
+    #ifdef USE_ATLAS
+    flat out int Box;
+    flat out int Face;
+    #endif
+    void main() {
+        int face = gl_VertexID / 6;
+        vec4 p = vec4(aPos, 1.0);
+        TexCoord = aTexCoord;
+        WorldPos = vec3(dot(aModelRow[0], p), dot(aModelRow[1], p), dot(aModelRow[2], p));
+        Normal = aNormalMatrix * aNormal;
+        Albedo = aFaceColor[face];
+    #ifdef USE_LOGO
+        LogoMask = (float(face) == aLogoFace) ? 1.0 : 0.0;
+    #endif
+    #ifdef USE_ATLAS
+        Box = int(aLogoFace); Face = face;
+    #endif
+        gl_Position = projection * view * vec4(WorldPos, 1.0);
+    }
+)";
+const char* cubeInstancedFS = R"(
+    #version 330 core
+    out vec4 FragColor;
+    in vec3 WorldPos;
+    in vec3 Normal;
+    in vec2 TexCoord;
+    flat in vec4 Albedo;
+    #ifdef USE_LOGO
+    flat in float LogoMask;
+    #endif
+    #ifdef USE_ATLAS
+    flat in int Box;
+    flat in int Face;
+    uniform sampler2D uAtlas;
+    uniform int uAtlasSize;
+    #endif
+    uniform sampler2D uLogoTexture;
+    layout (std140) uniform Frame { mat4 view; mat4 projection; vec4 camPos; }; // FrameData
+    uniform samplerCube uSpecularMap;
+    uniform sampler2D uBrdfLut;
+    uniform vec3 uIrradianceSH[9];
+    const float SPECULAR_MAX_LOD = 4.0; // Ibl::SPECULAR_LEVELS - 1
+    vec3 irradianceSH(vec3 n) {
+        return uIrradianceSH[0] + uIrradianceSH[1] * n.y + uIrradianceSH[2] * n.z + uIrradianceSH[3] * n.x
+             + uIrradianceSH[4] * (n.x * n.y) + uIrradianceSH[5] * (n.y * n.z) + uIrradianceSH[6] * (3.0 * n.z * n.z - 1.0)
+             + uIrradianceSH[7] * (n.x * n.z) + uIrradianceSH[8] * (n.x * n.x - n.y * n.y);
+    }
+    void main() {
+        vec3 N = normalize(Normal);
+        vec3 V = normalize(camPos.xyz - WorldPos);
+        vec3 R = reflect(-V, N);
+        vec3 albedo = Albedo.rgb;
+    #ifdef USE_LOGO
+        vec4 logo = texture(uLogoTexture, TexCoord);
+        albedo = mix(albedo, logo.rgb * albedo, logo.a * LogoMask);
+    #endif
+    #ifdef USE_ATLAS
+        // Atlas row Box: face after face, each size x size facelets row by row; dark plastic between them
+        int n = uAtlasSize;
+        vec2 grid = TexCoord * float(n);
+        ivec2 cell = clamp(ivec2(grid), ivec2(0), ivec2(n - 1));
+        albedo = texelFetch(uAtlas, ivec2(Face * n * n + cell.y * n + cell.x, Box), 0).rgb;
+        vec2 inCell = fract(grid);
+        if (any(lessThan(inCell, vec2(0.04))) || any(greaterThan(inCell, vec2(0.96)))) albedo = vec3(0.05);
+    #endif
         float F0 = 0.04; 
-        float F = fresnelSchlick(max(dot(N, V), 0.0), F0);
-        vec3 prefilteredColor = textureLod(uSkybox, R, uRoughness * 4.0).rgb; 
-        vec3 specular = prefilteredColor * F * 1.5; 
-        vec3 irradiance = textureLod(uSkybox, N, 4.0).rgb;
-        vec3 diffuse = irradiance * albedo * 1.2; 
+        vec2 brdf = texture(uBrdfLut, vec2(max(dot(N, V), 0.0), Albedo.a)).rg;
+        vec3 prefilteredColor = textureLod(uSpecularMap, R, Albedo.a * SPECULAR_MAX_LOD).rgb; 
+        vec3 specular = prefilteredColor * (F0 * brdf.x + brdf.y) * 1.5; 
+        vec3 diffuse = irradianceSH(N) * albedo * 1.2; 
         vec3 color = diffuse + specular;
         color = vec3(1.0) - exp(-color * 1.0);
         color = pow(color, vec3(1.0/2.2));   
@@ -119,49 +239,179 @@ const char* cubeFS = R"(
     }
 )";
 
+// Profiler overlay: flat-colored triangles in window pixels, origin top-left
+const char* overlayVS = R"(
+    #version 330 core
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec4 aColor;
+    uniform vec2 uScreen;
+    out vec4 vColor;
+    void main() {
+        vColor = aColor;
+        vec2 ndc = aPos / uScreen * 2.0 - 1.0;
+        gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    }
+)";
+const char* overlayFS = R"(
+    #version 330 core
+    in vec4 vColor;
+    out vec4 FragColor;
+    void main() { FragColor = vColor; }
+)";
+
+// ID-buffer picking: cubie index * 6 + face + 1 per pixel, 0 for background
+const char* idVS = R"(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    layout (location = 3) in vec4 aModelRow[3];
+    layout (std140) uniform Frame { mat4 view; mat4 projection; vec4 camPos; }; // FrameData
+    flat out uint Id;
+    void main() {
+        Id = uint(gl_InstanceID * 6 + gl_VertexID / 6 + 1);
+        vec4 p = vec4(aPos, 1.0);
+        gl_Position = projection * view * vec4(dot(aModelRow[0], p), dot(aModelRow[1], p), dot(aModelRow[2], p), 1.0);
+    }
+)";
+const char* idFS = R"(
+    #version 330 core
+    flat in uint Id;
+    out uint FragId;
+    void main() { FragId = Id; }
+)";
+
 class Shader {
 public:
-    GLuint ID;
-    Shader(const char* vCode, const char* fCode) {
-        GLuint vertex = CompileShader(vCode, GL_VERTEX_SHADER);
-        GLuint fragment = CompileShader(fCode, GL_FRAGMENT_SHADER);
+    GLuint ID; bool linked;
+    // defines (e.g. "#define USE_LOGO\n") go right after each #version line, so one source yields
+    // compile-time variants
+    Shader(const char* vCode, const char* fCode, const char* defines = "") : ID(0), linked(false) {
+        GLuint vertex = CompileShader(vCode, GL_VERTEX_SHADER, defines);
+        GLuint fragment = CompileShader(fCode, GL_FRAGMENT_SHADER, defines);
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        GLint ok = 0; glGetProgramiv(ID, GL_LINK_STATUS, &ok);
+        if (!ok) { std::cerr << "Shader Link Failed: " << InfoLog(ID, true) << std::endl; return; }
+        linked = true;
+        CacheUniforms();
+        GLuint frame = glGetUniformBlockIndex(ID, "Frame"); // camera data from FrameUniforms
+        if (frame != GL_INVALID_INDEX) glUniformBlockBinding(ID, frame, FRAME_BLOCK_BINDING);
     }
-    void use() { glUseProgram(ID); }
-    void setMat4(const std::string &name, const glm::mat4 &mat) const { glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
-    void setVec3(const std::string &name, const glm::vec3 &value) const { glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
-    void setVec4(const std::string &name, const glm::vec4 &value) const { glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
-    void setBool(const std::string &name, bool value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); }
-    void setFloat(const std::string &name, float value) const { glUniform1f(glGetUniformLocation(ID, name.c_str()), value); }
-    void setInt(const std::string &name, int value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), value); }
+    void use() const { glUseProgram(ID); }
+    // Locations are resolved once after linking; -1 (ignored by glUniform*) for unknown names. Callers
+    // look theirs up once too (as CubeUniforms does) and set uniforms by handle only.
+    GLint uniform(const std::string &name) const { auto it = uniforms.find(name); return (it != uniforms.end()) ? it->second : -1; }
+    void setMat4(GLint loc, const glm::mat4 &mat) const { glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]); }
+    void setMat3(GLint loc, const glm::mat3 &mat) const { glUniformMatrix3fv(loc, 1, GL_FALSE, &mat[0][0]); }
+    void setVec3(GLint loc, const glm::vec3 &value) const { glUniform3fv(loc, 1, &value[0]); }
+    void setVec4(GLint loc, const glm::vec4 &value) const { glUniform4fv(loc, 1, &value[0]); }
+    void setBool(GLint loc, bool value) const { glUniform1i(loc, (int)value); }
+    void setFloat(GLint loc, float value) const { glUniform1f(loc, value); }
+    void setInt(GLint loc, int value) const { glUniform1i(loc, value); }
 private:
-    GLuint CompileShader(const char* source, GLenum type) {
+    std::unordered_map<std::string, GLint> uniforms;
+    GLuint CompileShader(const char* source, GLenum type, const char* defines) {
+        std::string code(source);
+        size_t version = code.find("#version"), eol = code.find('\n', version);
+        if (version != std::string::npos && eol != std::string::npos) code.insert(eol + 1, defines);
+        const char* text = code.c_str();
         GLuint s = glCreateShader(type);
-        glShaderSource(s, 1, &source, NULL);
+        glShaderSource(s, 1, &text, NULL);
         glCompileShader(s);
+        GLint ok = 0; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+        if (!ok) std::cerr << (type == GL_VERTEX_SHADER ? "Vertex" : "Fragment") << " Shader Compile Failed: " << InfoLog(s, false) << std::endl;
         return s;
     }
+    static std::string InfoLog(GLuint obj, bool program) {
+        GLint len = 0; if (program) glGetProgramiv(obj, GL_INFO_LOG_LENGTH, &len); else glGetShaderiv(obj, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len > 0 ? len : 1, '\0');
+        if (program) glGetProgramInfoLog(obj, len, NULL, &log[0]); else glGetShaderInfoLog(obj, len, NULL, &log[0]);
+        return log;
+    }
+    void CacheUniforms() {
+        GLint count = 0, maxLen = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count); glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+        std::vector<char> buf(maxLen > 0 ? maxLen : 1);
+        for (GLint i = 0; i < count; i++) {
+            GLint size; GLenum type; GLsizei len = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)buf.size(), &len, &size, &type, buf.data());
+            std::string name(buf.data(), len);
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) name.resize(name.size() - 3); // arrays report "name[0]"
+            uniforms[name] = glGetUniformLocation(ID, name.c_str());
+        }
+    }
+};
+
+// Uniform handles of a cube program, resolved once per program
+struct CubeUniforms {
+    GLint model, normalMatrix, albedo, logoTexture, specularMap, brdfLut, irradianceSH, atlas, atlasSize;
+    CubeUniforms(const Shader& s) : model(s.uniform("model")), normalMatrix(s.uniform("normalMatrix")), albedo(s.uniform("uAlbedoColor")), logoTexture(s.uniform("uLogoTexture")),
+        specularMap(s.uniform("uSpecularMap")), brdfLut(s.uniform("uBrdfLut")), irradianceSH(s.uniform("uIrradianceSH")), atlas(s.uniform("uAtlas")), atlasSize(s.uniform("uAtlasSize")) {}
 };
 
-GLuint loadTexture(const char* path) {
+// One compiled permutation of a cube shader
+struct CubeProgram {
+    Shader shader; CubeUniforms u;
+    CubeProgram(const char* vs, const char* fs, const char* defines) : shader(vs, fs, defines), u(shader) {}
+};
+
+// Material variants of a cube face. The legacy path draws each with its own cubeFS permutation;
+// the instanced path keeps roughness per instance and only needs the logo permutation.
+enum CubeVariant { VARIANT_PLASTIC, VARIANT_STICKER, VARIANT_LOGO, CUBE_VARIANTS };
+struct CubeShaders {
+    CubeProgram legacy[CUBE_VARIANTS];
+    CubeProgram instanced, instancedLogo, instancedAtlas;
+    CubeShaders() : legacy{ CubeProgram(cubeVS, cubeFS, "#define ROUGHNESS 0.4\n"), CubeProgram(cubeVS, cubeFS, "#define ROUGHNESS 0.2\n"),
+                            CubeProgram(cubeVS, cubeFS, "#define ROUGHNESS 0.2\n#define USE_LOGO\n") },
+                    instanced(cubeInstancedVS, cubeInstancedFS, ""), instancedLogo(cubeInstancedVS, cubeInstancedFS, "#define USE_LOGO\n"),
+                    instancedAtlas(cubeInstancedVS, cubeInstancedFS, "#define USE_ATLAS\n") {}
+    bool linked() const {
+        for (const CubeProgram& p : legacy) if (!p.shader.linked) return false;
+        return instanced.shader.linked && instancedLogo.shader.linked && instancedAtlas.shader.linked;
+    }
+};
+
+// Uploads a baked DDS (make textures) level by level as stored, with no decode and no glGenerateMipmap.
+// False, with nothing uploaded, if the file is missing, is not a 2D texture (faces = 1) or cubemap
+// (faces = 6), or the driver lacks its format.
+bool loadCompressed(const std::string& path, int faces) {
+    DdsFile dds;
+    if (!dds.open(path) || dds.faceCount != faces) return false;
+    bool srgb = dds.format == DDS_BC1_SRGB || dds.format == DDS_BC3_SRGB;
+    if (!GLEW_EXT_texture_compression_s3tc || (srgb && !GLEW_EXT_texture_sRGB)) return false;
+    GLenum format;
+    switch (dds.format) {
+        case DDS_BC1_UNORM: format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+        case DDS_BC1_SRGB: format = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT; break;
+        case DDS_BC3_UNORM: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+        default: format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+    }
+    GLenum target = faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    for (int f = 0; f < faces; f++) for (int m = 0; m < dds.mipCount; m++) {
+        DdsLevel l = dds.level(f, m);
+        glCompressedTexImage2D(faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + f : GL_TEXTURE_2D, m, format, l.width, l.height, 0, (GLsizei)l.size, l.data);
+    }
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, dds.mipCount - 1);
+    return true;
+}
+
+// The baked DDS that stands in for a PNG: same name, .dds
+std::string bakedPath(const std::string& path) { return path.substr(0, path.rfind('.')) + ".dds"; }
+
+// Prefers the baked copy of path. Otherwise the texture starts as a 1x1 white placeholder and
+// stream swaps the decoded PNG in later.
+GLuint loadTexture(const char* path, TextureStream& stream) {
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format = (nrComponents == 4) ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(data);
-    } else {
+    if (!loadCompressed(bakedPath(path), 1)) {
         unsigned char white[] = {255, 255, 255, 255};
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        stream.attach(path, textureID, GL_TEXTURE_2D, false);
     }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -170,36 +420,39 @@ GLuint loadTexture(const char* path) {
     return textureID;
 }
 
-GLuint loadCubemap(std::vector<std::string> faces) {
+// baked: a six-face DDS of the same images. Without it the faces start as 1x1 gray and stream
+// replaces all six at once when they have decoded.
+GLuint loadCubemap(const std::vector<std::string>& faces, const std::string& baked, TextureStream& stream) {
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(false);
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            GLenum format = (nrChannels == 4) ? GL_SRGB_ALPHA : GL_SRGB;
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, width, height, 0, (nrChannels == 4 ? GL_RGBA : GL_RGB), GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        } else {
-            unsigned char gray[] = {50, 50, 50}; 
+    if (!loadCompressed(baked, 6)) {
+        unsigned char gray[] = {50, 50, 50};
+        for (unsigned int i = 0; i < faces.size(); i++) {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, gray);
+            stream.attach(faces[i], textureID, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, true);
         }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
     }
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP); 
     return textureID;
 }
 
 struct Vertex { float x, y, z; float nx, ny, nz; float u, v; };
+// Normal, right and up of each mesh face in FaceDir order; texture u runs along right, v along up
+const glm::vec3 faceFrames[6][3] = { { {1,0,0}, {0,0,-1}, {0,1,0} }, { {-1,0,0}, {0,0,1}, {0,1,0} }, { {0,1,0}, {1,0,0}, {0,0,-1} },
+                                     { {0,-1,0}, {1,0,0}, {0,0,1} }, { {0,0,1}, {1,0,0}, {0,1,0} }, { {0,0,-1}, {-1,0,0}, {0,1,0} } };
+// Per-cubie data for the instanced path: the top three rows of the (rigid) model matrix and its
+// rotation as the normal matrix, faces[i] holds the sticker rgb with roughness in alpha, logoFace is
+// the face index that samples the logo texture (-1 for none). Fills all 16 attribute slots of GL 3.3.
+struct CubieInstance { glm::vec4 modelRows[3]; glm::mat3 normalMatrix; std::array<glm::vec4, 6> faces; float logoFace; };
 class CubeMesh {
 public:
-    GLuint VAO, VBO;
+    GLuint VAO, VBO, instanceVBO;
     CubeMesh() {
         float s = 0.495f; 
         std::vector<Vertex> vertices;
@@ -212,17 +465,36 @@ public:
             vertices.push_back(v1); vertices.push_back(v2); vertices.push_back(v3);
             vertices.push_back(v1); vertices.push_back(v3); vertices.push_back(v4);
         };
-        addFace({1,0,0}, {0,0,-1}, {0,1,0}); addFace({-1,0,0}, {0,0,1}, {0,1,0});
-        addFace({0,1,0}, {1,0,0}, {0,0,-1}); addFace({0,-1,0}, {1,0,0}, {0,0,1});
-        addFace({0,0,1}, {1,0,0}, {0,1,0});  addFace({0,0,-1}, {-1,0,0}, {0,1,0});
+        for (const auto& f : faceFrames) addFace(f[0], f[1], f[2]);
         glGenVertexArrays(1, &VAO); glGenBuffers(1, &VBO);
         glBindVertexArray(VAO); glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0); glEnableVertexAttribArray(0);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3*sizeof(float))); glEnableVertexAttribArray(1);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6*sizeof(float))); glEnableVertexAttribArray(2);
+        glGenBuffers(1, &instanceVBO); glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, 27 * sizeof(CubieInstance), NULL, GL_STREAM_DRAW);
+        for (int i = 0; i < 16 - 3; i++) { glEnableVertexAttribArray(3 + i); glVertexAttribDivisor(3 + i, 1); }
+        pointInstances();
+        glBindVertexArray(0);
     }
     void drawFace(int faceIdx) { glBindVertexArray(VAO); glDrawArrays(GL_TRIANGLES, faceIdx * 6, 6); }
+    void drawInstanced(const std::vector<CubieInstance>& instances) {
+        glBindVertexArray(VAO); glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(CubieInstance), NULL, GL_STREAM_DRAW); // orphan last frame's storage
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(CubieInstance), instances.data());
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)instances.size());
+    }
+
+private:
+    // Instance attributes: model rows at 3-5, normal matrix at 6-8, face colors at 9-14, logo face at 15
+    void pointInstances() {
+        const char* base = nullptr;
+        for (int i = 0; i < 3; i++) glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(CubieInstance), base + offsetof(CubieInstance, modelRows) + i * sizeof(glm::vec4));
+        for (int i = 0; i < 3; i++) glVertexAttribPointer(6 + i, 3, GL_FLOAT, GL_FALSE, sizeof(CubieInstance), base + offsetof(CubieInstance, normalMatrix) + i * sizeof(glm::vec3));
+        for (int i = 0; i < 6; i++) glVertexAttribPointer(9 + i, 4, GL_FLOAT, GL_FALSE, sizeof(CubieInstance), base + offsetof(CubieInstance, faces) + i * sizeof(glm::vec4));
+        glVertexAttribPointer(15, 1, GL_FLOAT, GL_FALSE, sizeof(CubieInstance), base + offsetof(CubieInstance, logoFace));
+    }
 };
 
 class SkyboxMesh {
@@ -245,63 +517,257 @@ public:
     void draw() { glBindVertexArray(VAO); glDrawArrays(GL_TRIANGLES, 0, 36); glBindVertexArray(0); }
 };
 
+// Frame-time graph and per-phase readout drawn over the scene from a Profiler's statistics
+class ProfilerOverlay {
+public:
+    Shader shader;
+    ProfilerOverlay() : shader(overlayVS, overlayFS) {
+        screenLoc = shader.uniform("uScreen");
+        glGenVertexArrays(1, &VAO); glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO); glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0); glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex2D), (void*)0);
+        glEnableVertexAttribArray(1); glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex2D), (void*)offsetof(Vertex2D, color));
+        glBindVertexArray(0);
+    }
+
+    void draw(const Profiler& p, int width, int height) {
+        const float GRAPH_MS = 50.0f, GRAPH_H = 80.0f, X = 10.0f, Y = 10.0f;
+        const glm::vec4 panel(0.0f, 0.0f, 0.0f, 0.6f), label(0.9f, 0.9f, 0.9f, 1.0f);
+        verts.clear();
+        rect(X, Y, Profiler::HISTORY * 2.0f + 20.0f, 60.0f + GRAPH_H + 20.0f, panel);
+        char line[160];
+        std::snprintf(line, sizeof(line), "FRAME %.2f MS  AVG %.2f  P99 %.2f", p.frameMs(), p.frameMeanMs(), p.framePercentileMs(0.99));
+        text(X + 10, Y + 10, line, label);
+        std::string cpu = "CPU", gpu = "GPU";
+        for (int i = 0; i < p.phaseCount(); i++) {
+            std::snprintf(line, sizeof(line), " %s %.2f", p.phaseName(i).c_str(), p.cpuMs(i)); cpu += line;
+            if (p.gpuMs(i) > 0) { std::snprintf(line, sizeof(line), " %s %.2f", p.phaseName(i).c_str(), p.gpuMs(i)); gpu += line; }
+        }
+        text(X + 10, Y + 26, cpu, label);
+        text(X + 10, Y + 42, p.gpuAvailable() ? gpu : "GPU N/A", label);
+        // Newest frame on the right; green up to 60 Hz, yellow up to 30 Hz, red beyond
+        float base = Y + 60.0f + GRAPH_H;
+        for (int age = 0; age < p.recordedFrames(); age++) {
+            float ms = p.frameHistory(age), h = std::min(ms, GRAPH_MS) / GRAPH_MS * GRAPH_H;
+            glm::vec4 c = ms <= 16.7f ? glm::vec4(0.2f, 0.9f, 0.2f, 1.0f) : (ms <= 33.4f ? glm::vec4(0.95f, 0.8f, 0.1f, 1.0f) : glm::vec4(0.95f, 0.2f, 0.1f, 1.0f));
+            rect(X + 10.0f + (Profiler::HISTORY - 1 - age) * 2.0f, base - h, 2.0f, h, c);
+        }
+        for (float ms : { 16.7f, 33.3f }) rect(X + 10.0f, base - ms / GRAPH_MS * GRAPH_H, Profiler::HISTORY * 2.0f, 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.5f));
+
+        glDisable(GL_DEPTH_TEST); glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        shader.use(); glUniform2f(screenLoc, (float)width, (float)height);
+        glBindVertexArray(VAO); glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(Vertex2D), verts.data(), GL_STREAM_DRAW);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)verts.size());
+        glBindVertexArray(0);
+        glDisable(GL_BLEND); glEnable(GL_DEPTH_TEST);
+    }
+
+private:
+    struct Vertex2D { float x, y; glm::vec4 color; };
+    GLuint VAO, VBO; GLint screenLoc;
+    std::vector<Vertex2D> verts;
+
+    void rect(float x, float y, float w, float h, const glm::vec4& c) {
+        Vertex2D a{ x, y, c }, b{ x + w, y, c }, d{ x + w, y + h, c }, e{ x, y + h, c };
+        verts.insert(verts.end(), { a, b, d, a, d, e });
+    }
+
+    // 3x5 pixel font, rows top to bottom; characters without a glyph advance as spaces
+    static const char* glyph(char ch) {
+        static const char* const digits[10] = {
+            "111101101101111", "010110010010111", "111001111100111", "111001111001111", "101101111001001",
+            "111100111001111", "111100111101111", "111001001001001", "111101111101111", "111101111001111" };
+        static const char* const letters[26] = {
+            "010101111101101", "110101110101110", "011100100100011", "110101101101110", "111100110100111", "111100110100100",
+            "011100101101011", "101101111101101", "111010010010111", "001001001101010", "101101110101101", "100100100100111",
+            "101111111101101", "110101101101101", "010101101101010", "110101110100100", "010101101110011", "110101110101101",
+            "011100010001110", "111010010010010", "101101101101111", "101101101101010", "101101111111101", "101101010101101",
+            "101101010010010", "111001010100111" };
+        if (ch >= '0' && ch <= '9') return digits[ch - '0'];
+        if (ch >= 'a' && ch <= 'z') ch = (char)(ch - 'a' + 'A');
+        if (ch >= 'A' && ch <= 'Z') return letters[ch - 'A'];
+        if (ch == '.') return "000000000000010";
+        if (ch == ':') return "000010000010000";
+        if (ch == '-') return "000000111000000";
+        return nullptr;
+    }
+
+    void text(float x, float y, const std::string& s, const glm::vec4& c) {
+        const float PX = 2.0f;
+        for (char ch : s) {
+            if (const char* g = glyph(ch))
+                for (int r = 0; r < 5; r++) for (int col = 0; col < 3; col++) if (g[r * 3 + col] == '1') rect(x + col * PX, y + r * PX, PX, PX, c);
+            x += 4 * PX;
+        }
+    }
+};
+// Render slot at a fixed grid position (0..size-1 per axis, last = size-1); RubiksCube refreshes
+// stickers/logoFace from its CubeNxN. turn() moves a 3x3x3 cubie by itself, the model --bench
+// compares the state tables against.
 struct Cubie {
-    int x, y, z; std::array<glm::vec4, 6> stickers; bool isCenterFace; 
-    Cubie(int px, int py, int pz) : x(px), y(py), z(pz) {
-        stickers[POS_X] = (px == 1) ? GREEN : BLACK_PLASTIC; stickers[NEG_X] = (px == -1) ? BLUE : BLACK_PLASTIC;
-        stickers[POS_Y] = (py == 1) ? WHITE : BLACK_PLASTIC; stickers[NEG_Y] = (py == -1) ? YELLOW : BLACK_PLASTIC;
-        stickers[POS_Z] = (pz == 1) ? RED : BLACK_PLASTIC; stickers[NEG_Z] = (pz == -1) ? ORANGE : BLACK_PLASTIC;
-        isCenterFace = (x == 0 && y == 0 && z == 1);
-    }
-    void rotateX(int times) { times = ((times % 4) + 4) % 4; for (int i = 0; i < times; i++) { int newY = -z; int newZ = y; y = newY; z = newZ; auto temp = stickers[POS_Y]; stickers[POS_Y] = stickers[NEG_Z]; stickers[NEG_Z] = stickers[NEG_Y]; stickers[NEG_Y] = stickers[POS_Z]; stickers[POS_Z] = temp; } }
-    void rotateY(int times) { times = ((times % 4) + 4) % 4; for (int i = 0; i < times; i++) { int newX = z; int newZ = -x; x = newX; z = newZ; auto temp = stickers[POS_X]; stickers[POS_X] = stickers[POS_Z]; stickers[POS_Z] = stickers[NEG_X]; stickers[NEG_X] = stickers[NEG_Z]; stickers[NEG_Z] = temp; } }
-    void rotateZ(int times) { times = ((times % 4) + 4) % 4; for (int i = 0; i < times; i++) { int newX = -y; int newY = x; x = newX; y = newY; auto temp = stickers[POS_X]; stickers[POS_X] = stickers[NEG_Y]; stickers[NEG_Y] = stickers[NEG_X]; stickers[NEG_X] = stickers[POS_Y]; stickers[POS_Y] = temp; } }
-
-    void draw(Shader& shader, CubeMesh& mesh, glm::mat4 modelMatrix, GLuint logoTex, GLuint skyboxTex) {
-        shader.setMat4("model", modelMatrix);
-        glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex); shader.setInt("uSkybox", 1);
+    int x, y, z, last; std::array<glm::vec4, 6> stickers; int logoFace; 
+    Cubie(int px, int py, int pz, int size) : x(px), y(py), z(pz), last(size - 1) {
+        stickers[POS_X] = (px == last) ? GREEN : BLACK_PLASTIC; stickers[NEG_X] = (px == 0) ? BLUE : BLACK_PLASTIC;
+        stickers[POS_Y] = (py == last) ? WHITE : BLACK_PLASTIC; stickers[NEG_Y] = (py == 0) ? YELLOW : BLACK_PLASTIC;
+        stickers[POS_Z] = (pz == last) ? RED : BLACK_PLASTIC; stickers[NEG_Z] = (pz == 0) ? ORANGE : BLACK_PLASTIC;
+        logoFace = (2 * x == last && 2 * y == last && z == last) ? POS_Z : -1;
+    }
+    // One move of the 3x3x3 (last == 2) straight from its table: the new slot, then the stickers'
+    // new directions. Only cubies for which t.turns() holds should be passed.
+    void turn(const MoveTable& t) {
+        int slot = t.slotTo[x * 9 + y * 3 + z]; x = slot / 9; y = slot / 3 % 3; z = slot % 3;
+        std::array<glm::vec4, 6> old = stickers;
+        for (int d = 0; d < 6; d++) stickers[d] = old[t.dirFrom[d]];
+    }
+
+    // modelMatrix is a rotation plus a translation, so its upper 3x3 already is the normal matrix
+    CubieInstance instance(const glm::mat4& modelMatrix) const {
+        CubieInstance inst;
+        for (int r = 0; r < 3; r++) inst.modelRows[r] = glm::vec4(modelMatrix[0][r], modelMatrix[1][r], modelMatrix[2][r], modelMatrix[3][r]);
+        inst.normalMatrix = glm::mat3(modelMatrix); inst.logoFace = (float)logoFace;
+        for (int i = 0; i < 6; i++) inst.faces[i] = glm::vec4(glm::vec3(stickers[i]), (stickers[i] != BLACK_PLASTIC) ? 0.2f : 0.4f);
+        return inst;
+    }
+
+    CubeVariant variant(int face) const { return face == logoFace ? VARIANT_LOGO : (stickers[face] != BLACK_PLASTIC ? VARIANT_STICKER : VARIANT_PLASTIC); }
+    // The faces of one variant, with p already in use
+    void draw(const CubeProgram& p, CubeVariant v, CubeMesh& mesh, const glm::mat4& modelMatrix) const {
+        bool placed = false;
         for (int i = 0; i < 6; i++) {
-            bool useLogo = (isCenterFace && i == POS_Z);
-            bool isSticker = (stickers[i] != BLACK_PLASTIC);
-            shader.setVec4("uAlbedoColor", stickers[i]);
-            shader.setFloat("uRoughness", isSticker ? 0.2f : 0.4f); 
-            shader.setBool("uUseLogo", useLogo);
-            if (useLogo) { glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, logoTex); shader.setInt("uLogoTexture", 0); }
+            if (variant(i) != v) continue;
+            if (!placed) { p.shader.setMat4(p.u.model, modelMatrix); p.shader.setMat3(p.u.normalMatrix, glm::mat3(modelMatrix)); placed = true; }
+            p.shader.setVec4(p.u.albedo, stickers[i]);
             mesh.drawFace(i);
         }
     }
 };
 
-class RubiksCube {
+// The original move path on a 3x3x3: scan all 27 slots and move the ones in the turning layer. Only --bench uses it now.
+void cubieScanMove(std::vector<Cubie>& cubies, MoveType move) {
+    const MoveTable& t = moveTable(move);
+    for (auto& cubie : cubies) if (t.turns(cubie.x - 1, cubie.y - 1, cubie.z - 1)) cubie.turn(t);
+}
+
+// Renders cubie/face IDs into an integer target and reads back the pixel under the cursor. Only
+// that pixel is rasterized (scissor), so the cost is the vertex work, independent of window size.
+class IdPicker {
+public:
+    Shader shader;
+    IdPicker(int width, int height) : shader(idVS, idFS), fbo(0), color(0), depth(0) {
+        glGenFramebuffers(1, &fbo); glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glGenRenderbuffers(1, &color); glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glGenRenderbuffers(1, &depth); glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { std::cerr << "ID picking framebuffer incomplete" << std::endl; shader.linked = false; }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    ~IdPicker() { glDeleteFramebuffers(1, &fbo); glDeleteRenderbuffers(1, &color); glDeleteRenderbuffers(1, &depth); }
+    bool ready() const { return shader.linked; }
+
+    // x, y in GL window coordinates (origin bottom-left), seen through the camera last written to
+    // FrameUniforms. Waits for the GPU: use on clicks, not per frame.
+    bool pick(CubeMesh& mesh, const std::vector<CubieInstance>& instances, int x, int y, int& index, int& face) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glEnable(GL_SCISSOR_TEST); glScissor(x, y, 1, 1);
+        GLuint background[4] = { 0, 0, 0, 0 }; glClearBufferuiv(GL_COLOR, 0, background);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        shader.use();
+        mesh.drawInstanced(instances);
+        GLuint id = 0;
+        glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, &id);
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (id == 0 || id > instances.size() * 6) return false;
+        index = (int)(id - 1) / 6; face = (int)(id - 1) % 6;
+        return true;
+    }
+
 private:
-    std::vector<Cubie> cubies; CubeMesh mesh; GLuint logoTexture; GLuint skyboxTexture;
-    bool animating; MoveType currentMove; float animationAngle, targetAngle, animationSpeed;
-    std::vector<size_t> animatingCubies; int rotAxis; int rotDirection;
-    std::vector<std::array<int, 3>> originalPositions;
-    float cameraRotX, cameraRotY, cameraDistance; glm::mat4 viewMatrix, projMatrix; glm::vec3 camPos;
-    
-    // Move Queue for Solving
-    std::deque<MoveType> moveQueue;
-    std::vector<MoveType> history;
-    bool autoSolving;
+    GLuint fbo, color, depth;
+};
+
+// One bit per surface cubie of the largest cube
+const int MAX_SURFACE_CUBIES = CUBE_MAX_SIZE * CUBE_MAX_SIZE * CUBE_MAX_SIZE - (CUBE_MAX_SIZE - 2) * (CUBE_MAX_SIZE - 2) * (CUBE_MAX_SIZE - 2);
+typedef std::bitset<MAX_SURFACE_CUBIES> CubieMask;
+
+// Everything a frame draws: each cubie (slot, stickers, logo) with its model matrix, whole cubes drawn
+// as one box each (a scene's distance LOD), and the camera. boxes hold center and edge length;
+// boxFacelets holds each box's RGBA facelets, laid out as RubiksCube::appendFacelets() writes them.
+// The simulation fills one whole and hands it over; the render thread only ever reads it.
+struct RenderSnapshot {
+    std::vector<Cubie> cubies; std::vector<glm::mat4> models;
+    std::vector<glm::vec4> boxes; std::vector<uint8_t> boxFacelets; int boxSize = 0;
+    FrameData camera;
+};
 
-    void updateMatrices() {
-        projMatrix = glm::perspective(glm::radians(40.0f), (float)WINDOW_WIDTH/WINDOW_HEIGHT, 0.1f, 100.0f);
-        float radX = glm::radians(cameraRotX), radY = glm::radians(cameraRotY);
-        camPos.x = cameraDistance * cos(radX) * sin(radY); camPos.y = cameraDistance * sin(radX); camPos.z = cameraDistance * cos(radX) * cos(radY);
-        viewMatrix = glm::lookAt(camPos, glm::vec3(0,0,0), glm::vec3(0,1,0));
+// Camera orbiting the origin: pitch rotX and yaw rotY in degrees, distance kept within
+// [minDistance, maxDistance], aspect the window's unless set. view, proj and pos follow every change.
+struct OrbitCamera {
+    float rotX, rotY, distance, minDistance, maxDistance, farPlane, aspect; glm::mat4 view, proj; glm::vec3 pos;
+    OrbitCamera(float pitch, float yaw, float dist, float minDist, float maxDist, float far)
+        : rotX(pitch), rotY(yaw), distance(dist), minDistance(minDist), maxDistance(maxDist), farPlane(far), aspect((float)WINDOW_WIDTH/WINDOW_HEIGHT) { update(); }
+    void update() {
+        proj = glm::perspective(glm::radians(40.0f), aspect, 0.1f, farPlane);
+        float radX = glm::radians(rotX), radY = glm::radians(rotY);
+        pos.x = distance * cos(radX) * sin(radY); pos.y = distance * sin(radX); pos.z = distance * cos(radX) * cos(radY);
+        view = glm::lookAt(pos, glm::vec3(0,0,0), glm::vec3(0,1,0));
     }
+    void rotate(int dx, int dy) { rotY += dx * 0.5f; rotX += dy * 0.5f; rotX = glm::clamp(rotX, -89.0f, 89.0f); update(); }
+    void zoom(float step) { distance = glm::clamp(distance - step, minDistance, maxDistance); update(); }
+    void setAspect(float a) { aspect = a; update(); }
+    FrameData frame() const { return { view, proj, glm::vec4(pos, 1.0f) }; }
+};
+
+// An SDL input event for the cube. With GPU picking a left click is resolved on the render thread,
+// which owns the ID buffer: picked is then set and cubie/face hold the result (cubie -1 for a miss).
+struct InputEvent { SDL_Event event; bool picked; int cubie, face; };
+// Mouse state carried from one input event to the next
+struct DragState { bool rightDown = false, leftDown = false, dragging = false; int lastX = 0, lastY = 0, startX = 0, startY = 0, cubie = -1, face = -1; };
+
+class RubiksCube {
+private:
+    // facelets is what is drawn; state mirrors it on the 3x3x3 for the solver
+    CubeNxN facelets; int n; CubeState state; std::unique_ptr<AsyncSolver> solveJob; // created by seedScrambles() or the first solve
+    std::vector<Cubie> cubies; // surface only: the (n-2)^3 inner cubies are never visible
+    std::vector<int> slotAt; // cubie index at grid position (x*n + y)*n + z, -1 inside
+    // Cubie indices and membership bits of layer axis*n + layer, built once in the constructor
+    std::vector<std::vector<int>> layerSlots; std::vector<CubieMask> layerMasks;
+    // Turns in flight: all on one axis with at most one per layer, so they commute and animate together.
+    // Starting or finishing one only touches these fixed-size members.
+    struct ActiveTurn { LayerTurn turn; float targetAngle, angle, progress, seconds; };
+    ActiveTurn turns[CUBE_MAX_SIZE]; int turnCount, turnAxis;
+    int8_t turnOnLayer[CUBE_MAX_SIZE]; // index into turns of the turn on each layer of turnAxis, -1 for none
+    CubieMask animating; // union of the turning layers' masks
+    float turnSeconds, solveTurnSeconds; // duration of one quarter turn, manual and during auto-solve
+    double solveBudget; // seconds a solve may look for a shorter solution before it plays
+    OrbitCamera camera;
+    
+    // Turns waiting to start: a solution, or a replay's turns as they come due
+    std::deque<LayerTurn> moveQueue;
+    bool solving, autoSolving; // a solve job is searching; its solution is playing
+    Xoshiro256 rng; // scrambles of other sizes than the 3x3x3
+    std::unique_ptr<ScrambleQueue> scrambles; // 3x3x3 ones, solved ahead in the background
+    bool scramblePending, solveAfterScramble; // asked for before the next of scrambles was solved: update() applies it once it is, and then solves it if asked to
+    SessionWriter* recorder; std::chrono::steady_clock::time_point sessionStart;
+    // Replay: the next event of reader replay (if pending), due once replayMs (session time, advanced by
+    // dt * replaySpeed) reaches it
+    SessionReader* replay; SessionEvent replayEvent; bool replayPending; float replaySpeed; double replayMs;
+    bool dirty; // something visible changed since the last takeDirty()
 
     MoveType mapKeyToMove(SDL_Keycode key, bool shiftPressed) { 
-        float angle = fmod(fmod(cameraRotY, 360.0f) + 360.0f, 360.0f); 
+        float angle = fmod(fmod(camera.rotY, 360.0f) + 360.0f, 360.0f); 
         int orientation; 
         if (angle >= 315.0f || angle < 45.0f) orientation = 0;       
         else if (angle >= 45.0f && angle < 135.0f) orientation = 1;  
         else if (angle >= 135.0f && angle < 225.0f) orientation = 2; 
         else orientation = 3;                                        
         
-        bool topView = cameraRotX > 45.0f; 
-        bool bottomView = cameraRotX < -45.0f;
+        bool topView = camera.rotX > 45.0f; 
+        bool bottomView = camera.rotX < -45.0f;
 
         // FIXED MAPS: 0=Red(+Z), 1=Green(+X), 2=Orange(-Z), 3=Blue(-X)
         static const MoveType horizontalMap[4][6] = { 
@@ -354,88 +820,237 @@ private:
         return baseMove; 
     }
 
-    void performInstantMove(MoveType move) {
-        int axis = 0; int dir = 1; 
-        switch (move) { case MOVE_F: axis=2; dir=-1; break; case MOVE_F_PRIME: axis=2; dir=1; break; case MOVE_B: axis=2; dir=1; break; case MOVE_B_PRIME: axis=2; dir=-1; break; case MOVE_L: axis=0; dir=1; break; case MOVE_L_PRIME: axis=0; dir=-1; break; case MOVE_R: axis=0; dir=-1; break; case MOVE_R_PRIME: axis=0; dir=1; break; case MOVE_U: axis=1; dir=-1; break; case MOVE_U_PRIME: axis=1; dir=1; break; case MOVE_D: axis=1; dir=1; break; case MOVE_D_PRIME: axis=1; dir=-1; break; case MOVE_M: axis=0; dir=1; break; case MOVE_M_PRIME: axis=0; dir=-1; break; case MOVE_E: axis=1; dir=1; break; case MOVE_E_PRIME: axis=1; dir=-1; break; case MOVE_S: axis=2; dir=-1; break; case MOVE_S_PRIME: axis=2; dir=1; break; default: return; }
-        for (auto& cubie : cubies) {
-            bool sel = false;
-            switch (move) { case MOVE_F: case MOVE_F_PRIME: sel = (cubie.z == 1); break; case MOVE_B: case MOVE_B_PRIME: sel = (cubie.z == -1); break; case MOVE_L: case MOVE_L_PRIME: sel = (cubie.x == -1); break; case MOVE_R: case MOVE_R_PRIME: sel = (cubie.x == 1); break; case MOVE_U: case MOVE_U_PRIME: sel = (cubie.y == 1); break; case MOVE_D: case MOVE_D_PRIME: sel = (cubie.y == -1); break; case MOVE_M: case MOVE_M_PRIME: sel = (cubie.x == 0); break; case MOVE_E: case MOVE_E_PRIME: sel = (cubie.y == 0); break; case MOVE_S: case MOVE_S_PRIME: sel = (cubie.z == 0); break; default: break; }
-            if (sel) { int times = (dir > 0) ? 1 : 3; if (axis == 0) cubie.rotateX(times); else if (axis == 1) cubie.rotateY(times); else cubie.rotateZ(times); }
+    // Cubies are fixed slots; copy sticker colors from the model. The logo follows the F (red) center
+    // of an odd cube.
+    void syncStickers(const std::vector<int>& slots) {
+        for (int i : slots) {
+            Cubie& cubie = cubies[i];
+            cubie.logoFace = -1;
+            int middle = (2 * cubie.x == cubie.last) + (2 * cubie.y == cubie.last) + (2 * cubie.z == cubie.last);
+            for (int f = 0; f < 6; f++) {
+                Face c = facelets.facelet(cubie.x, cubie.y, cubie.z, (FaceDir)f);
+                cubie.stickers[f] = (c == FACE_NONE) ? BLACK_PLASTIC : faceColors[c];
+                if (c == FACE_F && middle == 2) cubie.logoFace = f;
+            }
         }
     }
+    // Camera distances and the pick box grow with the cube
+    float scale() const { return n / 3.0f; }
+
 
 public:
-    RubiksCube(GLuint skyboxTex) : logoTexture(0), skyboxTexture(skyboxTex), animating(false), animationAngle(0), targetAngle(90), animationSpeed(15.0f), cameraRotX(25), cameraRotY(-35), cameraDistance(12.0f), autoSolving(false) {
-        for (int x = -1; x <= 1; x++) for (int y = -1; y <= 1; y++) for (int z = -1; z <= 1; z++) cubies.emplace_back(x, y, z);
-        logoTexture = loadTexture("textures/logo.png");
-        updateMatrices(); 
+    // Only the cubies of the turned layer need their stickers refreshed
+    void performTurn(const LayerTurn& t) {
+        facelets.turn(t);
+        if (n == 3) state.apply(makeMove(t.axis, t.layer - 1, t.quarterTurns));
+        syncStickers(layerSlots[t.axis * n + t.layer]);
+        dirty = true;
     }
+    void performInstantMove(MoveType move) { performTurn(layerTurn(move, n)); }
 
-    void scramble() {
-        if (animating || autoSolving) return;
-        // Keep adding to history
-        for (int i = 0; i < 20; i++) {
-            int r = rand() % 18;
-            MoveType m = static_cast<MoveType>(r);
-            performInstantMove(m);
-            history.push_back(m);
+    explicit RubiksCube(int size) : facelets(size), n(facelets.size()), turnCount(0), turnAxis(0), turnSeconds(0.1f), solveTurnSeconds(0.06f), solveBudget(0.3), camera(25, -35, 12.0f * scale(), 6.0f * scale(), 25.0f * scale(), 100.0f * scale()), solving(false), autoSolving(false),
+        scramblePending(false), solveAfterScramble(false), recorder(nullptr), replay(nullptr), replayPending(false), replaySpeed(1.0f), replayMs(0), dirty(true) {
+        slotAt.assign((size_t)n * n * n, -1); layerSlots.resize(3 * n); layerMasks.resize(3 * n);
+        std::fill(turnOnLayer, turnOnLayer + CUBE_MAX_SIZE, -1);
+        for (int x = 0; x < n; x++) for (int y = 0; y < n; y++) for (int z = 0; z < n; z++) {
+            if (x > 0 && x < n - 1 && y > 0 && y < n - 1 && z > 0 && z < n - 1) continue;
+            int i = (int)cubies.size();
+            slotAt[((size_t)x * n + y) * n + z] = i;
+            layerSlots[x].push_back(i); layerSlots[n + y].push_back(i); layerSlots[2 * n + z].push_back(i);
+            layerMasks[x].set(i); layerMasks[n + y].set(i); layerMasks[2 * n + z].set(i);
+            cubies.emplace_back(x, y, z, n);
         }
     }
+
+    // A 3x3x3 scramble is taken from scrambles, never solved here; if the next one isn't ready yet (just
+    // after startup, while the tables load) it stays pending, unless wait is set
+    void scramble(bool wait = false) {
+        if (turnCount) return;
+        bool thenSolve = solveAfterScramble;
+        cancelSolve();
+        std::vector<LayerTurn> t;
+        if (n != 3) scrambleTurns(n, rng, t);
+        else {
+            if (!scrambles) scrambles.reset(new ScrambleQueue(0)); // unseeded, as rng is
+            std::vector<MoveType> moves;
+            scramblePending = !scrambles->next(moves, wait);
+            if (scramblePending) { solveAfterScramble = thenSolve; return; }
+            for (MoveType m : moves) t.push_back(layerTurn(m, n));
+        }
+        for (const LayerTurn& turn : t) performTurn(turn);
+        record({ SessionEvent::SCRAMBLE, { 0, 0, 0 }, 0 }); // replayed from the seed, not turn by turn
+        if (thenSolve) solve();
+    }
     
+    // Starts solving the current state in the background; update() queues each shorter solution the
+    // job reports (two-phase first, then better ones within solveBudget) and plays the last one
     void solve() {
-        if (animating || autoSolving || history.empty()) return;
-        autoSolving = true;
-        moveQueue.clear();
-        for (int i = history.size() - 1; i >= 0; i--) {
-            MoveType m = history[i];
-            MoveType inv = (m % 2 == 0) ? static_cast<MoveType>(m + 1) : static_cast<MoveType>(m - 1);
-            moveQueue.push_back(inv);
-        }
-        history.clear();
-    }
-
-    void startMove(MoveType move) { 
-        if (animating) return; 
-        animating = true; currentMove = move; animationAngle = 0; animatingCubies.clear(); originalPositions.clear(); 
-        if (!autoSolving) history.push_back(move); // Track manual moves
-        switch (move) { case MOVE_F: rotAxis=2; rotDirection=-1; break; case MOVE_F_PRIME: rotAxis=2; rotDirection=1; break; case MOVE_B: rotAxis=2; rotDirection=1; break; case MOVE_B_PRIME: rotAxis=2; rotDirection=-1; break; case MOVE_L: rotAxis=0; rotDirection=1; break; case MOVE_L_PRIME: rotAxis=0; rotDirection=-1; break; case MOVE_R: rotAxis=0; rotDirection=-1; break; case MOVE_R_PRIME: rotAxis=0; rotDirection=1; break; case MOVE_U: rotAxis=1; rotDirection=-1; break; case MOVE_U_PRIME: rotAxis=1; rotDirection=1; break; case MOVE_D: rotAxis=1; rotDirection=1; break; case MOVE_D_PRIME: rotAxis=1; rotDirection=-1; break; case MOVE_M: rotAxis=0; rotDirection=1; break; case MOVE_M_PRIME: rotAxis=0; rotDirection=-1; break; case MOVE_E: rotAxis=1; rotDirection=1; break; case MOVE_E_PRIME: rotAxis=1; rotDirection=-1; break; case MOVE_S: rotAxis=2; rotDirection=-1; break; case MOVE_S_PRIME: rotAxis=2; rotDirection=1; break; default: animating = false; return; } for (size_t i = 0; i < cubies.size(); i++) { bool sel = false; int x = cubies[i].x, y = cubies[i].y, z = cubies[i].z; switch (move) { case MOVE_F: case MOVE_F_PRIME: sel = (z == 1); break; case MOVE_B: case MOVE_B_PRIME: sel = (z == -1); break; case MOVE_L: case MOVE_L_PRIME: sel = (x == -1); break; case MOVE_R: case MOVE_R_PRIME: sel = (x == 1); break; case MOVE_U: case MOVE_U_PRIME: sel = (y == 1); break; case MOVE_D: case MOVE_D_PRIME: sel = (y == -1); break; case MOVE_M: case MOVE_M_PRIME: sel = (x == 0); break; case MOVE_E: case MOVE_E_PRIME: sel = (y == 0); break; case MOVE_S: case MOVE_S_PRIME: sel = (z == 0); break; default: break; } if (sel) { animatingCubies.push_back(i); originalPositions.push_back({x, y, z}); } } }
-    
-    void update() { 
-        if (!animating && !moveQueue.empty()) {
-            MoveType m = moveQueue.front(); moveQueue.pop_front();
-            startMove(m); return;
+        if (scramblePending) { solveAfterScramble = true; return; }
+        if (turnCount || solving || autoSolving) return;
+        if (n != 3) { std::cerr << "The solver only handles the 3x3x3" << std::endl; return; }
+        if (state.isSolved()) return;
+        if (!solveJob) solveJob.reset(new AsyncSolver());
+        solveJob->start(state, 22, solveBudget);
+        solving = true;
+    }
+    // The user moved the cube: a solution for the old state is no use any more, nor a pending scramble
+    void cancelSolve() {
+        scramblePending = solveAfterScramble = false;
+        if (solving) solveJob->cancel();
+        if (solving || autoSolving) moveQueue.clear();
+        solving = autoSolving = false;
+    }
+    // Plays turns the way a solution plays: at solve speed, and dropped by cancelSolve()
+    void playTurns(const std::vector<LayerTurn>& turns) { moveQueue.assign(turns.begin(), turns.end()); autoSolving = !moveQueue.empty(); }
+    void pollSolve() {
+        if (!solving) return;
+        bool finished = !solveJob->searching(); // before poll(), so the last solution is not missed
+        std::vector<MoveType> solution;
+        if (solveJob->poll(solution)) {
+            optimizeMoves(solution);
+            moveQueue.clear();
+            for (MoveType m : solution) moveQueue.push_back(layerTurn(m, n));
         }
+        if (finished) { solving = false; autoSolving = !moveQueue.empty(); }
+    }
+
+    // Starts animating t unless it conflicts with a turn in flight (another axis, or the same layer)
+    bool startTurn(const LayerTurn& t) {
+        if (t.quarterTurns == 0 || (turnCount && t.axis != turnAxis)) return false;
+        if (turnCount && turnOnLayer[t.layer] >= 0) return false;
+        float seconds = (autoSolving ? solveTurnSeconds : turnSeconds) * (abs(t.quarterTurns) == 2 ? 1.5f : 1.0f);
+        turnOnLayer[t.layer] = (int8_t)turnCount;
+        turns[turnCount++] = { t, t.quarterTurns * 90.0f, 0.0f, 0.0f, seconds };
+        turnAxis = t.axis;
+        animating |= layerMasks[t.axis * n + t.layer];
+        dirty = true;
+        record({ SessionEvent::TURN, t, 0 });
+        return true;
+    }
+    bool startMove(MoveType move) { return startTurn(layerTurn(move, n)); }
+
+    // Eased turn angle as a function of time, so turns take the same time at any frame rate
+    static float easeInOutCubic(float t) { return t < 0.5f ? 4.0f * t * t * t : 1.0f - 4.0f * (1.0f - t) * (1.0f - t) * (1.0f - t); }
+
+    // dt: seconds since the previous update. Queued moves start as soon as they commute with
+    // everything in flight, so e.g. R L' or U D2 turn at the same time.
+    void update(float dt) { 
+        if (scramblePending) scramble();
+        advanceReplay(dt);
+        pollSolve();
+        // A solve plays only once its job ends, though the two-phase result is in within milliseconds:
+        // every solution is for the state solve() started from, so after the first turn a shorter one
+        // no longer applies. solveBudget is the delay spent on finding it.
+        while (!solving && !scramblePending && !moveQueue.empty() && startTurn(moveQueue.front())) moveQueue.pop_front();
         if (moveQueue.empty()) autoSolving = false;
-        if (!animating) return; 
-        float speed = autoSolving ? 25.0f : animationSpeed;
-        animationAngle += speed; 
-        if (animationAngle >= targetAngle) { 
-            for (size_t idx : animatingCubies) { 
-                int times = (rotDirection > 0) ? 1 : 3; 
-                if (rotAxis == 0) cubies[idx].rotateX(times); 
-                else if (rotAxis == 1) cubies[idx].rotateY(times); 
-                else cubies[idx].rotateZ(times); 
-            } 
-            animating = false; 
-        } 
+        if (turnCount) dirty = true;
+        for (int k = 0; k < turnCount;) {
+            ActiveTurn& t = turns[k];
+            t.progress += dt / t.seconds;
+            t.angle = t.targetAngle * easeInOutCubic(std::min(t.progress, 1.0f));
+            if (t.progress < 1.0f) { k++; continue; }
+            LayerTurn done = t.turn;
+            animating &= ~layerMasks[done.axis * n + done.layer];
+            turnOnLayer[done.layer] = -1;
+            turns[k] = turns[--turnCount];
+            if (k < turnCount) turnOnLayer[turns[k].turn.layer] = (int8_t)k;
+            performTurn(done);
+        }
     }
+    bool isAnimating() const { return turnCount || !moveQueue.empty() || replay || solving || scramblePending; }
+    bool isSolving() const { return solving; }
+    int size() const { return n; }
+    // Offscreen export at another size than the window
+    void setViewport(int width, int height) { camera.setAspect((float)width / height); dirty = true; }
+
+    // On the 3x3x3 this starts solving scrambles ahead, which also loads the solver tables, and has the
+    // solve job prepare the optimal-search table solveBudget needs, both off the input path
+    void seedScrambles(uint64_t seed) {
+        rng = Xoshiro256(seed);
+        if (n != 3) return;
+        scrambles.reset(new ScrambleQueue(seed));
+        if (!solveJob) solveJob.reset(new AsyncSolver());
+        solveJob->preload();
+    }
+    // Appends every turn started and every scramble to writer (nullptr stops), timed from now
+    void setRecorder(SessionWriter* writer) { recorder = writer; sessionStart = std::chrono::steady_clock::now(); }
+    void record(SessionEvent e) {
+        if (!recorder) return;
+        e.ms = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sessionStart).count();
+        recorder->add(e);
+    }
+    // Plays reader's session on this cube, which must be fresh, of its size, with its scrambles seeded
+    // from it. speed scales its timing; 0 applies everything at once. Input turns wait until it ends.
+    void startReplay(SessionReader* reader, float speed) {
+        SessionEvent e;
+        if (speed <= 0) {
+            while (reader->next(e)) { if (e.kind == SessionEvent::SCRAMBLE) scramble(true); else { performTurn(e.turn); record(e); } }
+            return;
+        }
+        replay = reader; replaySpeed = speed; replayMs = 0;
+        replayPending = replay->next(replayEvent);
+    }
+    bool replaying() const { return replay != nullptr; }
+    void advanceReplay(float dt) {
+        if (!replay) return;
+        replayMs += dt * 1000.0 * replaySpeed;
+        while (replayPending && replayEvent.ms <= replayMs) {
+            if (replayEvent.kind == SessionEvent::SCRAMBLE) {
+                if (turnCount || !moveQueue.empty() || scramblePending) break; // it scrambled the cube as the turns before it left it
+                scramble();
+            } else moveQueue.push_back(replayEvent.turn);
+            replayPending = replay->next(replayEvent);
+        }
+        if (!replayPending) replay = nullptr;
+    }
+    // True once per change to the state, the turns in flight or the camera; the caller redraws then
+    bool takeDirty() { bool d = dirty; dirty = false; return d; }
     
-    void draw(Shader& shader) {
-        updateMatrices(); shader.setMat4("projection", projMatrix); shader.setMat4("view", viewMatrix); shader.setVec3("uCamPos", camPos);
-        for (size_t i = 0; i < cubies.size(); i++) {
-            glm::mat4 model = glm::mat4(1.0f); bool isAnim = false; size_t animIdx = 0; for(size_t k=0; k<animatingCubies.size(); k++) { if(animatingCubies[k] == i) { isAnim=true; animIdx=k; break; } }
-            if (isAnim && animating) { float angle = animationAngle * rotDirection; glm::vec3 axis = (rotAxis==0) ? glm::vec3(1,0,0) : ((rotAxis==1) ? glm::vec3(0,1,0) : glm::vec3(0,0,1)); model = glm::rotate(model, glm::radians(angle), axis); model = glm::translate(model, glm::vec3(originalPositions[animIdx][0], originalPositions[animIdx][1], originalPositions[animIdx][2])); } 
-            else { model = glm::translate(model, glm::vec3(cubies[i].x, cubies[i].y, cubies[i].z)); }
-            cubies[i].draw(shader, mesh, model, logoTexture, skyboxTexture);
-        }
-    }
-    void rotateCamera(int dx, int dy) { cameraRotY += dx * 0.5f; cameraRotX += dy * 0.5f; cameraRotX = glm::clamp(cameraRotX, -89.0f, 89.0f); updateMatrices(); }
-    void zoom(int dir) { cameraDistance -= dir * 1.0f; cameraDistance = glm::clamp(cameraDistance, 6.0f, 25.0f); updateMatrices(); }
-    void handleKeyPress(SDL_Keycode key, bool shift) { MoveType move = mapKeyToMove(key, shift); if (move != MOVE_NONE) startMove(move); }
+    glm::mat4 cubieModel(size_t i) const {
+        const Cubie& c = cubies[i];
+        glm::mat4 model = glm::mat4(1.0f);
+        if (animating.test(i)) {
+            const ActiveTurn& t = turns[turnOnLayer[(turnAxis == 0) ? c.x : ((turnAxis == 1) ? c.y : c.z)]];
+            model = glm::rotate(model, glm::radians(t.angle), glm::vec3(turnAxis == 0, turnAxis == 1, turnAxis == 2));
+        }
+        return glm::translate(model, glm::vec3(c.x, c.y, c.z) - glm::vec3(c.last * 0.5f));
+    }
+
+    // The current cubies, their turn-animated models and the camera, reusing out's storage
+    void snapshot(RenderSnapshot& out) const {
+        out.cubies.clear(); out.models.clear(); out.boxes.clear(); out.boxFacelets.clear();
+        appendCubies(out, glm::vec3(0.0f));
+        out.camera = camera.frame();
+    }
+    // The cubies moved by offset, after those already in out
+    void appendCubies(RenderSnapshot& out, const glm::vec3& offset) const {
+        glm::mat4 placement = glm::translate(glm::mat4(1.0f), offset);
+        for (size_t i = 0; i < cubies.size(); i++) { out.cubies.push_back(cubies[i]); out.models.push_back(placement * cubieModel(i)); }
+    }
+    // Every facelet as RGBA8: face after face in FaceDir order, each size x size row by row, with u
+    // along the face's faceFrames right and v along its up (so a box's texture coordinates find them)
+    void appendFacelets(std::vector<uint8_t>& out) const {
+        for (int f = 0; f < 6; f++) {
+            const glm::vec3* frame = faceFrames[f];
+            for (int v = 0; v < n; v++) for (int u = 0; u < n; u++) {
+                int c[3];
+                for (int a = 0; a < 3; a++)
+                    c[a] = frame[0][a] != 0.0f ? (frame[0][a] > 0.0f ? n - 1 : 0) : (n - 1 + (int)frame[1][a] * (2 * u - n + 1) + (int)frame[2][a] * (2 * v - n + 1)) / 2;
+                Face face = facelets.facelet(c[0], c[1], c[2], (FaceDir)f);
+                glm::vec4 color = (face == FACE_NONE) ? BLACK_PLASTIC : faceColors[face];
+                for (int k = 0; k < 4; k++) out.push_back((uint8_t)(color[k] * 255.0f + 0.5f));
+            }
+        }
+    }
+    void rotateCamera(int dx, int dy) { camera.rotate(dx, dy); dirty = true; }
+    void zoom(int dir) { camera.zoom(dir * 1.0f); dirty = true; }
+    void handleKeyPress(SDL_Keycode key, bool shift) { MoveType move = mapKeyToMove(key, shift); if (move != MOVE_NONE) { cancelSolve(); startMove(move); } }
     
     // INPUT HANDLING INSIDE CLASS
-    void handleInput(SDL_Event& e, bool& rDown, bool& lDown, int& lx, int& ly, int& cx, int& cy, int& pc, int& pf, bool& dc) {
+    void handleInput(const InputEvent& in, DragState& d) {
+        const SDL_Event& e = in.event;
         if(e.type==SDL_KEYDOWN){
+            if(replay) return;
             if(e.key.keysym.sym==SDLK_SPACE) scramble();
             else if(e.key.keysym.sym==SDLK_c) solve();
             else if(e.key.keysym.sym!=SDLK_ESCAPE) {
@@ -443,80 +1058,721 @@ public:
                 handleKeyPress(e.key.keysym.sym, s);
             }
         }
-        else if(e.type==SDL_MOUSEBUTTONDOWN){ if(e.button.button==3){rDown=true;lx=e.button.x;ly=e.button.y;} else if(e.button.button==1){lDown=true;cx=e.button.x;cy=e.button.y;dc=false; if(!pickCubie(cx,cy,pc,pf)) pc=-1;}}
-        else if(e.type==SDL_MOUSEBUTTONUP){if(e.button.button==3)rDown=false;else if(e.button.button==1)lDown=false;}
+        else if(e.type==SDL_MOUSEBUTTONDOWN){ if(e.button.button==3){d.rightDown=true;d.lastX=e.button.x;d.lastY=e.button.y;} else if(e.button.button==1){d.leftDown=true;d.startX=e.button.x;d.startY=e.button.y;d.dragging=false;
+            if(in.picked){d.cubie=in.cubie;d.face=in.face;} else if(!pickCubieAnalytic(d.startX,d.startY,d.cubie,d.face)) d.cubie=-1;}}
+        else if(e.type==SDL_MOUSEBUTTONUP){if(e.button.button==3)d.rightDown=false;else if(e.button.button==1)d.leftDown=false;}
         else if(e.type==SDL_MOUSEMOTION){
-            if(rDown){rotateCamera(e.motion.x-lx,e.motion.y-ly);lx=e.motion.x;ly=e.motion.y;}
-            else if(lDown&&pc!=-1&&!dc){ int dx=e.motion.x-cx,dy=e.motion.y-cy; if(dx*dx+dy*dy>MIN_DRAG_DISTANCE*MIN_DRAG_DISTANCE){
-                MoveType m=getMoveFromDrag(pf,pc,dx,dy); if(m!=MOVE_NONE){startMove(m); dc=true;}
+            if(d.rightDown){rotateCamera(e.motion.x-d.lastX,e.motion.y-d.lastY);d.lastX=e.motion.x;d.lastY=e.motion.y;}
+            else if(d.leftDown&&d.cubie!=-1&&!d.dragging){ int dx=e.motion.x-d.startX,dy=e.motion.y-d.startY; if(dx*dx+dy*dy>MIN_DRAG_DISTANCE*MIN_DRAG_DISTANCE){
+                LayerTurn t=getTurnFromDrag(d.face,d.cubie,dx,dy); if(t.quarterTurns && !replay){cancelSolve(); startTurn(t); d.dragging=true;}
             }}
         } else if(e.type==SDL_MOUSEWHEEL) {
             zoom(e.wheel.y);
         }
     }
 
-    bool pickCubie(int mouseX, int mouseY, int& outIndex, int& outFace) { updateMatrices(); glm::vec4 viewport = glm::vec4(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT); glm::vec3 winCoords = glm::vec3(mouseX, WINDOW_HEIGHT - mouseY, 0.0f); glm::vec3 nearPos = glm::unProject(glm::vec3(winCoords.x, winCoords.y, 0.0f), viewMatrix, projMatrix, viewport); glm::vec3 farPos = glm::unProject(glm::vec3(winCoords.x, winCoords.y, 1.0f), viewMatrix, projMatrix, viewport); glm::vec3 rayDir = glm::normalize(farPos - nearPos); glm::vec3 rayOrigin = nearPos; float minT = 1000.0f; int bestIdx = -1; int bestFace = -1; for(size_t i=0; i<cubies.size(); ++i) { glm::vec3 pos(cubies[i].x, cubies[i].y, cubies[i].z); for(int f=0; f<6; ++f) { if(cubies[i].stickers[f] == BLACK_PLASTIC) continue; glm::vec3 normal(0); if(f==POS_X) normal.x=1; else if(f==NEG_X) normal.x=-1; else if(f==POS_Y) normal.y=1; else if(f==NEG_Y) normal.y=-1; else if(f==POS_Z) normal.z=1; else if(f==NEG_Z) normal.z=-1; glm::vec3 faceCenter = pos + normal * 0.5f; float denom = glm::dot(normal, rayDir); if(fabs(denom) < 1e-6) continue; float t = glm::dot(faceCenter - rayOrigin, normal) / denom; if(t < 0 || t > minT) continue; glm::vec3 hitPoint = rayOrigin + t * rayDir; glm::vec3 localHit = hitPoint - pos; bool hit = false; float s = 0.5f; if (f < 2) hit = (fabs(localHit.y) <= s && fabs(localHit.z) <= s); else if (f < 4) hit = (fabs(localHit.x) <= s && fabs(localHit.z) <= s); else hit = (fabs(localHit.x) <= s && fabs(localHit.y) <= s); if(hit) { minT = t; bestIdx = i; bestFace = f; } } } if (bestIdx != -1) { outIndex = bestIdx; outFace = bestFace; return true; } return false; }
-    MoveType getMoveFromDrag(int faceDir, int cubieIndex, int dragDX, int dragDY) { if (cubieIndex < 0 || cubieIndex >= (int)cubies.size()) return MOVE_NONE; glm::mat4 invView = glm::inverse(viewMatrix); glm::vec3 camRight = glm::vec3(invView[0]); glm::vec3 camUp = glm::vec3(invView[1]); glm::vec3 worldDrag = (float)dragDX * camRight - (float)dragDY * camUp; float dragH = 0, dragV = 0; switch (faceDir) { case POS_Z: dragH = worldDrag.x; dragV = worldDrag.y; break; case NEG_Z: dragH = -worldDrag.x; dragV = worldDrag.y; break; case POS_X: dragH = -worldDrag.z; dragV = worldDrag.y; break; case NEG_X: dragH = worldDrag.z; dragV = worldDrag.y; break; case POS_Y: dragH = worldDrag.x; dragV = -worldDrag.z; break; case NEG_Y: dragH = worldDrag.x; dragV = worldDrag.z; break; } bool horizontal = fabs(dragH) > fabs(dragV); int dirH = (dragH > 0) ? 1 : -1; int dirV = (dragV > 0) ? 1 : -1; int cx = cubies[cubieIndex].x, cy = cubies[cubieIndex].y, cz = cubies[cubieIndex].z; if (faceDir == POS_Z || faceDir == NEG_Z) { if (horizontal) { if (cy == 1) return (dirH > 0) ? MOVE_U_PRIME : MOVE_U; if (cy == -1) return (dirH > 0) ? MOVE_D : MOVE_D_PRIME; return (dirH > 0) ? MOVE_E : MOVE_E_PRIME; } else { MoveType m; if (cx == 1) m = (dirV > 0) ? MOVE_R : MOVE_R_PRIME; else if (cx == -1) m = (dirV > 0) ? MOVE_L_PRIME : MOVE_L; else m = (dirV > 0) ? MOVE_M_PRIME : MOVE_M; if (faceDir == NEG_Z) { if (m == MOVE_R) m = MOVE_R_PRIME; else if (m == MOVE_R_PRIME) m = MOVE_R; if (m == MOVE_L) m = MOVE_L_PRIME; else if (m == MOVE_L_PRIME) m = MOVE_L; if (m == MOVE_M) m = MOVE_M_PRIME; else if (m == MOVE_M_PRIME) m = MOVE_M; } return m; } } else if (faceDir == POS_X || faceDir == NEG_X) { if (horizontal) { if (cy == 1) return (dirH > 0) ? MOVE_U_PRIME : MOVE_U; if (cy == -1) return (dirH > 0) ? MOVE_D : MOVE_D_PRIME; return (dirH > 0) ? MOVE_E : MOVE_E_PRIME; } else { MoveType m; if (cz == 1) m = (dirV > 0) ? MOVE_F_PRIME : MOVE_F; else if (cz == -1) m = (dirV > 0) ? MOVE_B : MOVE_B_PRIME; else m = (dirV > 0) ? MOVE_S_PRIME : MOVE_S; if (faceDir == NEG_X) { if (m == MOVE_F) m = MOVE_F_PRIME; else if (m == MOVE_F_PRIME) m = MOVE_F; if (m == MOVE_B) m = MOVE_B_PRIME; else if (m == MOVE_B_PRIME) m = MOVE_B; if (m == MOVE_S) m = MOVE_S_PRIME; else if (m == MOVE_S_PRIME) m = MOVE_S; } return m; } } else { if (horizontal) { MoveType m; if (cz == 1) m = (dirH > 0) ? MOVE_F : MOVE_F_PRIME; else if (cz == -1) m = (dirH > 0) ? MOVE_B_PRIME : MOVE_B; else m = (dirH > 0) ? MOVE_S : MOVE_S_PRIME; if (faceDir == NEG_Y) { if (m == MOVE_F) m = MOVE_F_PRIME; else if (m == MOVE_F_PRIME) m = MOVE_F; if (m == MOVE_B) m = MOVE_B_PRIME; else if (m == MOVE_B_PRIME) m = MOVE_B; if (m == MOVE_S) m = MOVE_S_PRIME; else if (m == MOVE_S_PRIME) m = MOVE_S; } return m; } else { MoveType m; if (cx == 1) m = (dirV > 0) ? MOVE_R : MOVE_R_PRIME; else if (cx == -1) m = (dirV > 0) ? MOVE_L_PRIME : MOVE_L; else m = (dirV > 0) ? MOVE_M_PRIME : MOVE_M; if (faceDir == NEG_Y) { if (m == MOVE_R) m = MOVE_R_PRIME; else if (m == MOVE_R_PRIME) m = MOVE_R; if (m == MOVE_L) m = MOVE_L_PRIME; else if (m == MOVE_L_PRIME) m = MOVE_L; if (m == MOVE_M) m = MOVE_M_PRIME; else if (m == MOVE_M_PRIME) m = MOVE_M; } return m; } } }
-    void getMatrices(glm::mat4& v, glm::mat4& p) { v = viewMatrix; p = projMatrix; }
+    // World-space ray under a window pixel
+    void pickRay(int mouseX, int mouseY, glm::vec3& origin, glm::vec3& dir) const {
+        glm::vec4 viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+        glm::vec3 nearPos = glm::unProject(glm::vec3(mouseX, WINDOW_HEIGHT - mouseY, 0.0f), camera.view, camera.proj, viewport);
+        glm::vec3 farPos = glm::unProject(glm::vec3(mouseX, WINDOW_HEIGHT - mouseY, 1.0f), camera.view, camera.proj, viewport);
+        origin = nearPos; dir = glm::normalize(farPos - nearPos);
+    }
+
+    // One slab test against the outer box (sticker faces lie on |coord| = n/2): the entry axis gives
+    // the face, the hit point rounded to the grid gives the cubie. Turning layers are picked at rest.
+    bool pickCubieAnalytic(int mouseX, int mouseY, int& outIndex, int& outFace) const {
+        const float H = n * 0.5f;
+        glm::vec3 origin, dir; pickRay(mouseX, mouseY, origin, dir);
+        float tNear = -1e30f, tFar = 1e30f; int axis = -1;
+        for (int a = 0; a < 3; a++) {
+            if (fabs(dir[a]) < 1e-8f) { if (fabs(origin[a]) > H) return false; continue; }
+            float t0 = (-H - origin[a]) / dir[a], t1 = (H - origin[a]) / dir[a];
+            if (t0 > t1) std::swap(t0, t1);
+            if (t0 > tNear) { tNear = t0; axis = a; }
+            tFar = std::min(tFar, t1);
+        }
+        if (axis < 0 || tNear > tFar || tNear < 0) return false;
+        glm::vec3 hit = origin + dir * tNear;
+        int c[3];
+        for (int a = 0; a < 3; a++) c[a] = (a == axis) ? (hit[a] > 0 ? n - 1 : 0) : glm::clamp((int)floor(hit[a] + H), 0, n - 1);
+        outIndex = slotAt[((size_t)c[0] * n + c[1]) * n + c[2]];
+        outFace = axis * 2 + (hit[axis] > 0 ? 0 : 1);
+        return true;
+    }
+
+    // The drag as a 3x3 move, classifying the picked cubie's layers as -1/0/1 (outer or inner)
+    MoveType dragMove(int faceDir, int cubieIndex, int dragDX, int dragDY) { if (cubieIndex < 0 || cubieIndex >= (int)cubies.size()) return MOVE_NONE; glm::mat4 invView = glm::inverse(camera.view); glm::vec3 camRight = glm::vec3(invView[0]); glm::vec3 camUp = glm::vec3(invView[1]); glm::vec3 worldDrag = (float)dragDX * camRight - (float)dragDY * camUp; float dragH = 0, dragV = 0; switch (faceDir) { case POS_Z: dragH = worldDrag.x; dragV = worldDrag.y; break; case NEG_Z: dragH = -worldDrag.x; dragV = worldDrag.y; break; case POS_X: dragH = -worldDrag.z; dragV = worldDrag.y; break; case NEG_X: dragH = worldDrag.z; dragV = worldDrag.y; break; case POS_Y: dragH = worldDrag.x; dragV = -worldDrag.z; break; case NEG_Y: dragH = worldDrag.x; dragV = worldDrag.z; break; } bool horizontal = fabs(dragH) > fabs(dragV); int dirH = (dragH > 0) ? 1 : -1; int dirV = (dragV > 0) ? 1 : -1; const Cubie& c = cubies[cubieIndex]; auto side = [&](int v) { return v == c.last ? 1 : (v == 0 ? -1 : 0); }; int cx = side(c.x), cy = side(c.y), cz = side(c.z); if (faceDir == POS_Z || faceDir == NEG_Z) { if (horizontal) { if (cy == 1) return (dirH > 0) ? MOVE_U_PRIME : MOVE_U; if (cy == -1) return (dirH > 0) ? MOVE_D : MOVE_D_PRIME; return (dirH > 0) ? MOVE_E : MOVE_E_PRIME; } else { MoveType m; if (cx == 1) m = (dirV > 0) ? MOVE_R : MOVE_R_PRIME; else if (cx == -1) m = (dirV > 0) ? MOVE_L_PRIME : MOVE_L; else m = (dirV > 0) ? MOVE_M_PRIME : MOVE_M; if (faceDir == NEG_Z) { if (m == MOVE_R) m = MOVE_R_PRIME; else if (m == MOVE_R_PRIME) m = MOVE_R; if (m == MOVE_L) m = MOVE_L_PRIME; else if (m == MOVE_L_PRIME) m = MOVE_L; if (m == MOVE_M) m = MOVE_M_PRIME; else if (m == MOVE_M_PRIME) m = MOVE_M; } return m; } } else if (faceDir == POS_X || faceDir == NEG_X) { if (horizontal) { if (cy == 1) return (dirH > 0) ? MOVE_U_PRIME : MOVE_U; if (cy == -1) return (dirH > 0) ? MOVE_D : MOVE_D_PRIME; return (dirH > 0) ? MOVE_E : MOVE_E_PRIME; } else { MoveType m; if (cz == 1) m = (dirV > 0) ? MOVE_F_PRIME : MOVE_F; else if (cz == -1) m = (dirV > 0) ? MOVE_B : MOVE_B_PRIME; else m = (dirV > 0) ? MOVE_S_PRIME : MOVE_S; if (faceDir == NEG_X) { if (m == MOVE_F) m = MOVE_F_PRIME; else if (m == MOVE_F_PRIME) m = MOVE_F; if (m == MOVE_B) m = MOVE_B_PRIME; else if (m == MOVE_B_PRIME) m = MOVE_B; if (m == MOVE_S) m = MOVE_S_PRIME; else if (m == MOVE_S_PRIME) m = MOVE_S; } return m; } } else { if (horizontal) { MoveType m; if (cz == 1) m = (dirH > 0) ? MOVE_F : MOVE_F_PRIME; else if (cz == -1) m = (dirH > 0) ? MOVE_B_PRIME : MOVE_B; else m = (dirH > 0) ? MOVE_S : MOVE_S_PRIME; if (faceDir == NEG_Y) { if (m == MOVE_F) m = MOVE_F_PRIME; else if (m == MOVE_F_PRIME) m = MOVE_F; if (m == MOVE_B) m = MOVE_B_PRIME; else if (m == MOVE_B_PRIME) m = MOVE_B; if (m == MOVE_S) m = MOVE_S_PRIME; else if (m == MOVE_S_PRIME) m = MOVE_S; } return m; } else { MoveType m; if (cx == 1) m = (dirV > 0) ? MOVE_R : MOVE_R_PRIME; else if (cx == -1) m = (dirV > 0) ? MOVE_L_PRIME : MOVE_L; else m = (dirV > 0) ? MOVE_M_PRIME : MOVE_M; if (faceDir == NEG_Y) { if (m == MOVE_R) m = MOVE_R_PRIME; else if (m == MOVE_R_PRIME) m = MOVE_R; if (m == MOVE_L) m = MOVE_L_PRIME; else if (m == MOVE_L_PRIME) m = MOVE_L; if (m == MOVE_M) m = MOVE_M_PRIME; else if (m == MOVE_M_PRIME) m = MOVE_M; } return m; } } }
+    // The same turn on the picked cubie's own layer
+    LayerTurn getTurnFromDrag(int faceDir, int cubieIndex, int dragDX, int dragDY) {
+        MoveGeometry g = moveGeometry(dragMove(faceDir, cubieIndex, dragDX, dragDY));
+        if (g.quarterTurns == 0) return { 0, 0, 0 };
+        const Cubie& c = cubies[cubieIndex];
+        return { g.axis, g.axis == 0 ? c.x : (g.axis == 1 ? c.y : c.z), g.quarterTurns };
+    }
+};
+
+// Planes of the frustum of viewProj (Gribb and Hartmann), normalized, inside where dot(n, p) + w >= 0
+void frustumPlanes(const glm::mat4& viewProj, glm::vec4 (&planes)[6]) {
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; r++) row[r] = glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 p = (i & 1) ? row[3] - row[i / 2] : row[3] + row[i / 2];
+        planes[i] = p / glm::length(glm::vec3(p));
+    }
+}
+
+// --scene N: a wall of N independent cubes, each scrambling itself and playing back the solution over
+// and over, orbited by one camera (right drag, wheel). A snapshot holds only what that camera sees:
+// cubes outside the view frustum are left out, and those too small on screen to show their turns
+// collapse to one box each, so the cost follows what is visible rather than N.
+class CubeScene {
+public:
+    static constexpr float LOD_PIXELS = 40.0f; // cubes narrower than this on screen are drawn as boxes
+    static constexpr float REST_SECONDS = 1.0f; // pause after each scramble and each solve
+
+    CubeScene(int count, int size, uint64_t seed) : n(size), scrambleSeed(seed), nextScramble(0), rng(seed), camera(10, -20, 1, 1, 1, 1), viewHeight(WINDOW_HEIGHT), dirty(true) {
+        if (n == 3) scrambles.reset(new ScrambleQueue(seed));
+        int cols = (int)std::ceil(std::sqrt((double)count)), rows = (count + cols - 1) / cols;
+        float spacing = n * 1.6f, half = std::max(cols, rows) * spacing * 0.5f;
+        float fit = half * 1.15f / std::tan(glm::radians(20.0f)) + n; // the whole wall in view, with a margin
+        camera = OrbitCamera(10, -20, fit, n * 4.0f, fit * 2.0f, fit * 2.0f + half * 3.0f);
+        cubes.resize(count);
+        for (int i = 0; i < count; i++) {
+            Member& m = cubes[i];
+            m.cube.reset(new RubiksCube(n));
+            m.position = glm::vec3((i % cols - (cols - 1) * 0.5f) * spacing, ((rows - 1) * 0.5f - i / cols) * spacing, 0.0f);
+            scramble(m); // only those the queue has ready: the rest start solved
+            m.rest = (float)(rng.next() >> 40) / (1 << 24) * 2.0f * REST_SECONDS; // staggered, so they don't all turn in step
+        }
+    }
+
+    // Orbit and zoom only; the cubes play by themselves
+    void handleInput(const InputEvent& in, DragState& d) {
+        const SDL_Event& e = in.event;
+        if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == 3) { d.rightDown = true; d.lastX = e.button.x; d.lastY = e.button.y; }
+        else if (e.type == SDL_MOUSEBUTTONUP && e.button.button == 3) d.rightDown = false;
+        else if (e.type == SDL_MOUSEMOTION && d.rightDown) { camera.rotate(e.motion.x - d.lastX, e.motion.y - d.lastY); d.lastX = e.motion.x; d.lastY = e.motion.y; dirty = true; }
+        else if (e.type == SDL_MOUSEWHEEL) { camera.zoom(e.wheel.y * camera.distance * 0.1f); dirty = true; }
+    }
+
+    // Each cube rests, then plays its solution if it is scrambled or takes the next scramble if not (or,
+    // if none is solved yet, rests again)
+    void update(float dt) {
+        for (Member& m : cubes) {
+            m.cube->update(dt);
+            if (m.cube->isAnimating() || (m.rest -= dt) > 0) continue;
+            m.rest = REST_SECONDS;
+            if (!m.solution.empty()) { m.cube->playTurns(m.solution); m.solution.clear(); }
+            else scramble(m);
+        }
+        dirty = true;
+    }
+    bool isAnimating() const { return true; }
+    bool takeDirty() { bool d = dirty; dirty = false; return d; }
+    // Offscreen export at another size than the window; LOD follows the pixels actually drawn
+    void setViewport(int width, int height) { camera.setAspect((float)width / height); viewHeight = height; dirty = true; }
+
+    void snapshot(RenderSnapshot& out) const {
+        out.cubies.clear(); out.models.clear(); out.boxes.clear(); out.boxFacelets.clear();
+        out.boxSize = n; out.camera = camera.frame();
+        glm::vec4 planes[6]; frustumPlanes(camera.proj * camera.view, planes);
+        const float radius = n * 0.8660254f; // half the cube's diagonal
+        const float focal = viewHeight / (2.0f * std::tan(glm::radians(20.0f))); // pixels per unit at distance 1
+        for (const Member& m : cubes) {
+            bool inside = true;
+            for (const glm::vec4& p : planes) inside = inside && glm::dot(glm::vec3(p), m.position) + p.w >= -radius;
+            if (!inside) continue;
+            if (n * focal / glm::length(camera.pos - m.position) >= LOD_PIXELS) m.cube->appendCubies(out, m.position);
+            else { out.boxes.push_back(glm::vec4(m.position, (float)n)); m.cube->appendFacelets(out.boxFacelets); }
+        }
+    }
+
+private:
+    struct Member { std::unique_ptr<RubiksCube> cube; glm::vec3 position; float rest; std::vector<LayerTurn> solution; };
+    std::vector<Member> cubes; int n;
+    // 3x3x3 scrambles come from scrambles, solved ahead in the background; those of other sizes are
+    // cheap, scramble i being Xoshiro256(seed, i)'s, whichever cube takes it
+    std::unique_ptr<ScrambleQueue> scrambles;
+    uint64_t scrambleSeed, nextScramble; Xoshiro256 rng;
+    OrbitCamera camera; int viewHeight;
+    bool dirty;
+
+    // Applies the next scramble at once, if there is one ready; its inverse, the solve, is kept for later
+    void scramble(Member& m) {
+        std::vector<LayerTurn> turns;
+        if (scrambles) {
+            std::vector<MoveType> moves;
+            if (!scrambles->next(moves)) return;
+            for (MoveType move : moves) turns.push_back(layerTurn(move, n));
+        } else {
+            Xoshiro256 r(scrambleSeed, nextScramble++);
+            scrambleTurns(n, r, turns);
+        }
+        for (const LayerTurn& t : turns) m.cube->performTurn(t);
+        m.solution.assign(turns.rbegin(), turns.rend());
+        for (LayerTurn& t : m.solution) t.quarterTurns = -t.quarterTurns;
+    }
+};
+
+// The GL side of the cube: mesh, logo, environment, camera block and the per-frame instance data
+// built from a RenderSnapshot. Only ever used on the thread that holds the context.
+class CubeRenderer {
+public:
+    CubeRenderer(const Ibl& environment, FrameUniforms& frameUniforms, GLuint logo) : logoTexture(logo), ibl(environment), frame(frameUniforms), atlas(0), atlasWidth(0), atlasRows(0) {}
+
+    // The camera for every pass drawn after it (cube, skybox, ID picking); once per frame
+    void writeFrame(const RenderSnapshot& s) { frame.write(s.camera); }
+    void endFrame() { frame.endFrame(); }
+
+    // Prefiltered specular on unit 1, BRDF LUT on unit 2, irradiance as SH uniforms; the logo on
+    // unit 0. p must be in use; the camera comes from writeFrame().
+    void bindEnvironment(const CubeProgram& p) {
+        glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, logoTexture); p.shader.setInt(p.u.logoTexture, 0);
+        glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.specularMap); p.shader.setInt(p.u.specularMap, 1);
+        glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, ibl.brdfLut); p.shader.setInt(p.u.brdfLut, 2);
+        glUniform3fv(p.u.irradianceSH, 9, ibl.irradiance);
+    }
+
+    // Legacy path: one drawFace call per face (156 on the 3x3x3), grouped into one pass per shader variant
+    void draw(const RenderSnapshot& s, CubeShaders& shaders) {
+        for (int v = 0; v < CUBE_VARIANTS; v++) {
+            const CubeProgram& p = shaders.legacy[v];
+            p.shader.use(); bindEnvironment(p);
+            for (size_t i = 0; i < s.cubies.size(); i++) s.cubies[i].draw(p, (CubeVariant)v, mesh, s.models[i]);
+        }
+        drawBoxes(s, shaders);
+    }
+
+    // Instanced path: one draw; the USE_LOGO variant only when a cubie carries the logo (its mask is
+    // per instance, so a second pass for that one cubie would cost more than it saves)
+    void drawInstanced(const RenderSnapshot& s, CubeShaders& shaders) {
+        bool logo = buildInstances(s);
+        const CubeProgram& p = logo ? shaders.instancedLogo : shaders.instanced;
+        p.shader.use(); bindEnvironment(p);
+        mesh.drawInstanced(instances);
+        drawBoxes(s, shaders);
+    }
+
+    // LOD boxes: the cubie mesh scaled up to each whole cube, all in one more instanced draw, colored
+    // from an atlas uploaded from the snapshot's facelets (row i for box i, nearest filtering). Its
+    // storage is only reallocated when the number of boxes or their size changes.
+    void drawBoxes(const RenderSnapshot& s, CubeShaders& shaders) {
+        if (s.boxes.empty()) return;
+        glActiveTexture(GL_TEXTURE3); // first: unit 2, active after bindEnvironment(), holds the BRDF LUT
+        if (!atlas) {
+            glGenTextures(1, &atlas); glBindTexture(GL_TEXTURE_2D, atlas);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        } else glBindTexture(GL_TEXTURE_2D, atlas);
+        GLsizei width = 6 * s.boxSize * s.boxSize, rows = (GLsizei)s.boxes.size();
+        if (width == atlasWidth && rows == atlasRows) glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, s.boxFacelets.data());
+        else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, s.boxFacelets.data());
+            atlasWidth = width; atlasRows = rows;
+        }
+        instances.resize(s.boxes.size());
+        for (size_t i = 0; i < s.boxes.size(); i++) {
+            const glm::vec4& b = s.boxes[i];
+            CubieInstance& inst = instances[i];
+            for (int r = 0; r < 3; r++) { inst.modelRows[r] = glm::vec4(0.0f); inst.modelRows[r][r] = b.w; inst.modelRows[r][3] = b[r]; }
+            inst.normalMatrix = glm::mat3(1.0f); inst.logoFace = (float)i;
+            inst.faces.fill(glm::vec4(0.0f, 0.0f, 0.0f, 0.2f)); // only the sticker roughness is used
+        }
+        const CubeProgram& p = shaders.instancedAtlas;
+        p.shader.use(); bindEnvironment(p);
+        p.shader.setInt(p.u.atlas, 3); p.shader.setInt(p.u.atlasSize, s.boxSize);
+        mesh.drawInstanced(instances);
+    }
+
+    // The cubie and face under a window pixel of the frame s shows, through picker's ID buffer
+    bool pick(const RenderSnapshot& s, IdPicker& picker, int mouseX, int mouseY, int& outIndex, int& outFace) {
+        buildInstances(s);
+        writeFrame(s); // the camera may have moved since the last frame was drawn
+        if (!picker.pick(mesh, instances, mouseX, WINDOW_HEIGHT - 1 - mouseY, outIndex, outFace)) return false;
+        return s.cubies[outIndex].stickers[outFace] != BLACK_PLASTIC; // a gap between cubies shows inner plastic
+    }
+
+private:
+    CubeMesh mesh; GLuint logoTexture; const Ibl& ibl; FrameUniforms& frame;
+    GLuint atlas; GLsizei atlasWidth, atlasRows; // LOD box facelets, created on first use; its storage's size
+    std::vector<CubieInstance> instances; // per-frame scratch, one per cubie or box
+
+    // True if a cubie carries the logo
+    bool buildInstances(const RenderSnapshot& s) {
+        bool logo = false;
+        instances.resize(s.cubies.size());
+        for (size_t i = 0; i < s.cubies.size(); i++) { instances[i] = s.cubies[i].instance(s.models[i]); logo |= s.cubies[i].logoFace >= 0; }
+        return logo;
+    }
 };
 
+// Runs a world (a RubiksCube, or a CubeScene) on its own thread: input, turns, replay, recording and
+// solves all happen there, and each visible change is published whole as a RenderSnapshot through a
+// triple buffer. The render thread only takes the newest one, so neither a solve nor a blocking swap
+// holds up the other side. A world provides handleInput(const InputEvent&, DragState&), update(dt),
+// isAnimating(), takeDirty() and snapshot(RenderSnapshot&).
+class Simulation {
+public:
+    typedef std::chrono::steady_clock Clock;
+    static constexpr double TICK_SECONDS = 1.0 / 240; // update interval while anything moves
+
+    // wakeEvent: an SDL user event type, pushed to wake the render thread when a snapshot is new
+    explicit Simulation(Uint32 wakeEvent) : wakeType(wakeEvent), quit(false), wakePending(false) {}
+    ~Simulation() { stop(); }
+    // Publishes the world's current state right away, then runs it; it must not be touched until stop()
+    template <class World> void start(World& world) {
+        world.takeDirty();
+        publish(world);
+        thread = std::thread([this, &world] { run(world); });
+    }
+    void stop() {
+        { std::lock_guard<std::mutex> lock(mutex); quit = true; }
+        wake.notify_one();
+        if (thread.joinable()) thread.join();
+    }
+    void post(const InputEvent& e) {
+        { std::lock_guard<std::mutex> lock(mutex); inbox.push_back(e); }
+        wake.notify_one();
+    }
+
+    // Render thread: true if a snapshot newer than front() came in since the last call; front() is
+    // then the newest and stays valid until the next call
+    bool takeSnapshot() {
+        wakePending.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with publish(): one side sees the other
+        return snapshots.acquire();
+    }
+    const RenderSnapshot& front() const { return snapshots.front(); }
+
+private:
+    Uint32 wakeType;
+    std::thread thread;
+    std::mutex mutex; std::condition_variable wake; // guard inbox and quit
+    std::deque<InputEvent> inbox; bool quit;
+    TripleBuffer<RenderSnapshot> snapshots;
+    std::atomic<bool> wakePending; // a wake event is queued that the render thread has not acted on
+
+    // Sleeps until input while the world is still, otherwise until input or the next tick
+    template <class World> void run(World& world) {
+        DragState drag; std::vector<InputEvent> batch;
+        Clock::time_point last = Clock::now();
+        const Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(TICK_SECONDS));
+        for (;;) {
+            bool idle = !world.isAnimating();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto ready = [this] { return quit || !inbox.empty(); };
+                if (idle) wake.wait(lock, ready);
+                else wake.wait_until(lock, last + tick, ready);
+                if (quit) return;
+                batch.assign(inbox.begin(), inbox.end()); inbox.clear();
+            }
+            Clock::time_point now = Clock::now();
+            if (idle) last = now; // time spent waiting for input is not animation time
+            for (const InputEvent& e : batch) world.handleInput(e, drag);
+            world.update((float)std::min(std::chrono::duration<double>(now - last).count(), 0.1)); // a stall doesn't skip whole animations
+            last = now;
+            if (world.takeDirty()) publish(world);
+        }
+    }
+
+    // One wake event at a time: the render thread takes the newest snapshot whenever it wakes
+    template <class World> void publish(World& world) {
+        world.snapshot(snapshots.back()); snapshots.publish();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (wakePending.exchange(true, std::memory_order_relaxed)) return;
+        SDL_Event e = {}; e.type = wakeType;
+        SDL_PushEvent(&e);
+    }
+};
+
+// Swap-interval selection and frame pacing. Prefers adaptive vsync (late frames tear instead of
+// waiting a whole refresh), then vsync, and otherwise sleeps off the rest of each frame itself.
+// While nothing moves it drops to idleHz so a static scene stops burning a core.
+class FramePacer {
+public:
+    enum SyncMode { SYNC_NONE, SYNC_VSYNC, SYNC_ADAPTIVE };
+    typedef std::chrono::steady_clock Clock;
+
+    explicit FramePacer(int hz) : mode(SYNC_NONE), period(1.0 / hz), frameStart(Clock::now()) {}
+
+    // Needs a current GL context; useVsync = false keeps the swap unsynchronized and paced by sleeping
+    void init(bool useVsync) {
+        if (useVsync && SDL_GL_SetSwapInterval(-1) == 0) mode = SYNC_ADAPTIVE;
+        else if (useVsync && SDL_GL_SetSwapInterval(1) == 0) mode = SYNC_VSYNC;
+        else { SDL_GL_SetSwapInterval(0); mode = SYNC_NONE; }
+    }
+    SyncMode syncMode() const { return mode; }
+
+    // Animation time is the simulation's; frames only need their start for the deadline
+    void beginFrame() { frameStart = Clock::now(); }
+
+    // After the swap: with vsync the swap already waited; otherwise sleep to the frame deadline
+    void endFrame() {
+        if (mode != SYNC_NONE) return;
+        Clock::time_point deadline = frameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+        // Coarse sleep, then yield for the last millisecond where the OS timer isn't precise enough
+        for (Clock::time_point now = Clock::now(); now < deadline; now = Clock::now()) {
+            double left = std::chrono::duration<double, std::milli>(deadline - now).count();
+            if (left > 2.0) SDL_Delay((Uint32)(left - 1.0));
+            else std::this_thread::yield();
+        }
+    }
+
+private:
+    SyncMode mode;
+    double period;
+    Clock::time_point frameStart;
+};
+
+// --bench: CPU cost of the move paths and of submitting one frame's cube draw, in BenchReport format
+void runBench(SDL_Window* window, RubiksCube& cube, CubeRenderer& renderer, CubeShaders& cubeShaders, BenchReport& report) {
+    typedef std::chrono::steady_clock Clock;
+    auto seconds = [](Clock::time_point since) { return std::chrono::duration<double>(Clock::now() - since).count(); };
+    Xoshiro256 rng(1);
+    std::vector<MoveType> moves; randomMoveScramble(rng, 4096, moves);
+
+    const int N = 200000;
+    std::vector<Cubie> cubies;
+    for (int x = 0; x < 3; x++) for (int y = 0; y < 3; y++) for (int z = 0; z < 3; z++) cubies.emplace_back(x, y, z, 3);
+    Clock::time_point t = Clock::now();
+    for (int i = 0; i < N; i++) cubieScanMove(cubies, moves[i & 4095]);
+    report.add("cubie_scan_move", "moves_per_sec", N / seconds(t), "1/s");
+    CubeState state;
+    t = Clock::now();
+    for (int i = 0; i < N; i++) state.apply(moves[i & 4095]);
+    report.add("state_apply", "moves_per_sec", N / seconds(t), "1/s");
+    volatile int sink = cubies[0].x + state.cp[0]; (void)sink;
+    t = Clock::now();
+    for (int i = 0; i < N / 10; i++) cube.performInstantMove(moves[i & 4095]); // state apply plus sticker sync
+    report.add("instant_move", "moves_per_sec", (N / 10) / seconds(t), "1/s");
+    t = Clock::now();
+    for (int i = 0; i < N / 10; i++) { cube.startMove(moves[i & 4095]); cube.update(1.0f); } // one whole animation per update
+    report.add("animated_move", "moves_per_sec", (N / 10) / seconds(t), "1/s");
+
+    // Picking over a grid of window pixels, analytic and then through the ID buffer
+    IdPicker picker(WINDOW_WIDTH, WINDOW_HEIGHT);
+    RenderSnapshot snapshot; cube.snapshot(snapshot);
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<double> samples; int index, face;
+        for (int y = 0; y < WINDOW_HEIGHT; y += 16) for (int x = 0; x < WINDOW_WIDTH; x += 16) {
+            t = Clock::now();
+            if (pass == 1) renderer.pick(snapshot, picker, x, y, index, face);
+            else cube.pickCubieAnalytic(x, y, index, face);
+            samples.push_back(seconds(t) * 1e6);
+        }
+        report.addDistribution(pass == 1 ? "pick_id_buffer" : "pick_analytic", samples, "us");
+    }
+
+    // Publishing one snapshot, the simulation thread's cost per visible change
+    std::vector<double> copies;
+    for (int i = 0; i < 1000; i++) { t = Clock::now(); cube.snapshot(snapshot); copies.push_back(seconds(t) * 1e6); }
+    report.addDistribution("snapshot", copies, "us");
+
+    const int WARMUP = 30, FRAMES = 300;
+    for (int pass = 0; pass < 2; pass++) {
+        bool instanced = pass == 1;
+        std::vector<double> samples;
+        for (int f = 0; f < WARMUP + FRAMES; f++) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            t = Clock::now();
+            renderer.writeFrame(snapshot);
+            if (instanced) renderer.drawInstanced(snapshot, cubeShaders);
+            else renderer.draw(snapshot, cubeShaders);
+            if (f >= WARMUP) samples.push_back(seconds(t) * 1e6);
+            renderer.endFrame();
+            glFinish(); // keep the driver queue from absorbing the next frame's submission
+            SDL_GL_SwapWindow(window);
+        }
+        report.addDistribution(instanced ? "draw_instanced" : "draw_legacy", samples, "us");
+    }
+}
+
+// Offscreen export: frame k shows the world after k steps of 1/fps seconds however long each took to
+// draw, so a video keeps its timing. frames 0 runs until the world is at rest. Each frame is read back
+// while the next one is drawn; draw(snapshot) renders one into the bound target.
+template <class World, class Draw> bool exportFrames(World& world, int frames, int fps, RenderTarget& target, FrameWriter& writer, Draw draw) {
+    typedef std::chrono::steady_clock Clock;
+    FrameReader reader; reader.init(target.width, target.height);
+    world.setViewport(target.width, target.height);
+    RenderSnapshot snapshot; std::vector<uint8_t> pixels;
+    bool ok = true;
+    Clock::time_point start = Clock::now();
+    for (int k = 0; ok; k++) {
+        world.snapshot(snapshot);
+        target.bind();
+        draw(snapshot);
+        target.resolve();
+        reader.capture();
+        if (reader.take(pixels)) ok = writer.write(pixels.data());
+        if (frames ? k + 1 >= frames : !world.isAnimating()) break;
+        world.update(1.0f / fps);
+    }
+    if (ok && reader.take(pixels, true)) ok = writer.write(pixels.data());
+    reader.release();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cerr << "Exported " << writer.frames() << " frames of " << target.width << "x" << target.height << " in " << seconds << " s (" << writer.frames() / seconds << " per second)" << std::endl;
+    return ok;
+}
+
 int main(int argc, char* argv[]) {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) { std::cerr << "SDL Init Failed: " << SDL_GetError() << std::endl; return 1; }
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1); SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
-
-    SDL_Window* window = SDL_CreateWindow("Rubiks PBR (Fixed Input)", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
-    if (!window) { std::cerr << "Window Create Failed: " << SDL_GetError() << std::endl; return 1; }
-    
-    SDL_GLContext context = SDL_GL_CreateContext(window);
-    if (!context) { std::cerr << "Context Create Failed: " << SDL_GetError() << std::endl; return 1; }
-    
+    // --gen-tables: build every solver table (including the optimal-search one) into the cache file and exit
+    if (argc > 1 && std::strcmp(argv[1], "--gen-tables") == 0) {
+        solverTables().ensureCornerPrune();
+        return 0;
+    }
+    // --bench [--csv] [--no-header] [--label name]: run the render-side benchmarks and exit
+    // --no-vsync: unsynchronized swaps paced by sleeping; --fps N: frame cap without vsync (default 60)
+    // --gpu-pick: pick through the ID buffer instead of the analytic ray test
+    // --size N: an NxNxN cube, 2 to 17 (the solver only works on the default 3)
+    // --seed N: seed for the scrambles (default: the time); --record FILE: write the session to FILE
+    // --replay FILE [--replay-speed X]: play a recorded session, X times as fast (0: all at once; default 1)
+    // --scene N: a wall of N cubes (up to MAX_SCENE) of --size, scrambling and solving themselves
+    // --offscreen WxH: no window; W x H frames as fast as the GPU draws them, each 1/--fps seconds on, to
+    //   --out PATH: PNGs (PATH a pattern like frame_%04d.png, the default), raw RGB24 (.rgb) or Y4M (.y4m,
+    //   or - for stdout); --frames N of them (default 1, or until the cube is still after --replay or
+    //   --solve); --scramble starts from a scramble, --solve solves it first
+    const int MAX_SCENE = 1024;
+    bool bench = false, vsync = true, gpuPick = false; int fps = 60, size = 3, sceneCount = 0;
+    int exportWidth = 0, exportHeight = 0, exportCount = 0; std::string exportPath = "frame_%04d.png"; bool exportScramble = false, exportSolve = false;
+    uint64_t seed = (uint64_t)std::time(nullptr); std::string recordPath, replayPath; float replaySpeed = 1.0f;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--bench") == 0) bench = true;
+        else if (std::strcmp(argv[i], "--no-vsync") == 0) vsync = false;
+        else if (std::strcmp(argv[i], "--gpu-pick") == 0) gpuPick = true;
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) fps = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) replaySpeed = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) sceneCount = glm::clamp(std::atoi(argv[++i]), 0, MAX_SCENE);
+        else if (std::strcmp(argv[i], "--offscreen") == 0 && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &exportWidth, &exportHeight) != 2 || exportWidth < 1 || exportHeight < 1) { std::cerr << "--offscreen takes WIDTHxHEIGHT" << std::endl; return 1; }
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) exportPath = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) exportCount = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--scramble") == 0) exportScramble = true;
+        else if (std::strcmp(argv[i], "--solve") == 0) exportSolve = true;
+    }
+    // A replay brings its own cube size and seed, so its scrambles come out the same
+    SessionReader replay;
+    if (!replayPath.empty()) {
+        if (!replay.open(replayPath)) { std::cerr << "Not a session recording: " << replayPath << std::endl; return 1; }
+        size = replay.cubeSize(); seed = replay.sessionSeed();
+    }
+    // PNGs without a baked copy start decoding now, in parallel with SDL and GL start-up
+    const std::vector<std::string> faces = { "textures/right.png", "textures/left.png", "textures/top.png", "textures/bottom.png", "textures/front.png", "textures/back.png" };
+    const char* LOGO_FILE = "textures/logo.png"; const std::string SKYBOX_FILE = "textures/skybox.dds";
+    TextureStream textures;
+    {
+        DdsFile probe;
+        if (!probe.open(SKYBOX_FILE)) textures.prefetch(faces);
+        if (!probe.open(bakedPath(LOGO_FILE))) textures.prefetch({ LOGO_FILE });
+    }
+
+    if (bench && exportWidth) { std::cerr << "--bench measures the window, not --offscreen" << std::endl; return 1; }
+    FrameWriter exportWriter;
+    if (exportWidth && !exportWriter.open(exportPath, FrameWriter::formatFor(exportPath), exportWidth, exportHeight, fps)) return 1;
+
+    OffscreenContext offscreen;
+    SDL_Window* window = nullptr; SDL_GLContext context = nullptr;
+    if (exportWidth) {
+        if (!offscreen.init()) return 1;
+    } else {
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) { std::cerr << "SDL Init Failed: " << SDL_GetError() << std::endl; return 1; }
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+        SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1); SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
+
+        window = SDL_CreateWindow("Rubiks PBR (Fixed Input)", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_OPENGL | (bench ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN));
+        if (!window) { std::cerr << "Window Create Failed: " << SDL_GetError() << std::endl; return 1; }
+        
+        context = SDL_GL_CreateContext(window);
+        if (!context) { std::cerr << "Context Create Failed: " << SDL_GetError() << std::endl; return 1; }
+    }
+
     glewExperimental = GL_TRUE; 
-    if (glewInit() != GLEW_OK) { std::cerr << "GLEW Init Failed" << std::endl; return 1; }
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if (exportWidth && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY) glewStatus = GLEW_OK; // a GLX build of GLEW under EGL: the GL entry points did load
+#endif
+    if (glewStatus != GLEW_OK) { std::cerr << "GLEW Init Failed" << std::endl; return 1; }
 
     glEnable(GL_DEPTH_TEST); glEnable(GL_MULTISAMPLE); glEnable(GL_FRAMEBUFFER_SRGB); 
-    std::srand(std::time(nullptr));
 
-    Shader cubeShader(cubeVS, cubeFS);
+    CubeShaders cubeShaders;
     Shader skyboxShader(skyboxVS, skyboxFS);
+    if (!cubeShaders.linked() || !skyboxShader.linked) { std::cerr << "Shader Setup Failed" << std::endl; return 1; }
     SkyboxMesh skyboxMesh;
+    FrameUniforms frameUniforms; frameUniforms.init();
 
-    std::vector<std::string> faces = { "textures/right.png", "textures/left.png", "textures/top.png", "textures/bottom.png", "textures/front.png", "textures/back.png" };
-    GLuint skyboxTex = loadCubemap(faces);
+    GLuint skyboxTex = loadCubemap(faces, SKYBOX_FILE, textures);
+
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    Ibl ibl; ibl.init(faces, textures); // on a cache miss, baked from the faces textures decodes
+    CubeRenderer renderer(ibl, frameUniforms, loadTexture(LOGO_FILE, textures));
+    RubiksCube cube(size);
+    if (bench) {
+        textures.finish(); ibl.finish(); textures.release();
+        BenchReport report; report.parseArgs(argc, argv);
+        runBench(window, cube, renderer, cubeShaders, report);
+        report.write(std::cout);
+        frameUniforms.release();
+        SDL_GL_DeleteContext(context); SDL_DestroyWindow(window); SDL_Quit();
+        return 0;
+    }
 
-    RubiksCube cube(skyboxTex);
+    // A scene's LOD atlas holds one row of 6 * size^2 facelets per box
+    std::unique_ptr<CubeScene> scene;
+    if (sceneCount > 0) {
+        GLint maxTexture = 0; glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+        if (6 * cube.size() * cube.size() > maxTexture || sceneCount > maxTexture) { std::cerr << "Scene too large for this GPU's textures" << std::endl; return 1; }
+        if (!recordPath.empty() || !replayPath.empty()) std::cerr << "Scenes are not recorded or replayed" << std::endl;
+        scene.reset(new CubeScene(sceneCount, cube.size(), seed));
+    } else cube.seedScrambles(seed); // not for the benchmark, which its background solves would disturb
+
+    SessionWriter recorder;
+    if (!recordPath.empty() && !scene) {
+        if (recorder.open(recordPath, cube.size(), seed)) cube.setRecorder(&recorder);
+        else std::cerr << "Could not write " << recordPath << std::endl;
+    }
+    if (!replayPath.empty() && !scene) cube.startReplay(&replay, replaySpeed);
+
+    if (exportWidth) {
+        textures.finish(); ibl.finish(); textures.release(); // every texture in place before the first frame
+        if (exportScramble) cube.scramble(true);
+        if (exportSolve) {
+            cube.solve();
+            while (cube.isSolving()) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); cube.update(0.0f); } // the solution starts on frame 0
+        }
+        auto draw = [&](const RenderSnapshot& s) {
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderer.writeFrame(s);
+            renderer.drawInstanced(s, cubeShaders);
+            glDepthFunc(GL_LEQUAL);
+            skyboxShader.use();
+            glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
+            skyboxMesh.draw();
+            glDepthFunc(GL_LESS);
+            renderer.endFrame();
+        };
+        RenderTarget target;
+        bool ok = target.init(exportWidth, exportHeight, 4);
+        if (!ok) std::cerr << "Offscreen framebuffer incomplete" << std::endl;
+        else if (scene) ok = exportFrames(*scene, exportCount, fps, target, exportWriter, draw);
+        else ok = exportFrames(cube, exportCount ? exportCount : (cube.isAnimating() ? 0 : 1), fps, target, exportWriter, draw);
+        ok = exportWriter.close() && ok;
+        if (!ok) std::cerr << "Export failed" << std::endl;
+        target.release(); frameUniforms.release();
+        offscreen.release();
+        return ok ? 0 : 1;
+    }
+
+    std::unique_ptr<IdPicker> idPicker;
+    if (gpuPick) {
+        idPicker.reset(new IdPicker(WINDOW_WIDTH, WINDOW_HEIGHT));
+        if (!idPicker->ready()) idPicker.reset();
+    }
+
+    // From here on the cube (or scene) belongs to the simulation thread; this one draws its snapshots
+    Simulation sim(SDL_RegisterEvents(1));
+    if (scene) sim.start(*scene);
+    else sim.start(cube);
+    sim.takeSnapshot();
 
     bool running = true; SDL_Event event;
-    bool rightDown = false; bool leftDown = false; int lastX=0, lastY=0; int clickStartX=0, clickStartY=0; int pickedCubie=-1, pickedFace=-1; bool draggingCube=false;
+    bool instancedDraw = true; // 'I' toggles back to the per-face path for comparison
+
+    // F3 toggles the profiler overlay, F4 writes the recorded frames to TRACE_FILE
+    const char* TRACE_FILE = "frame_trace.json";
+    const int IDLE_WAIT_MS = 250; // longest single idle wait; waking without an event draws nothing
+    Profiler profiler; profiler.initGpu();
+    ProfilerOverlay overlay;
+    if (!overlay.shader.linked) { std::cerr << "Shader Setup Failed" << std::endl; return 1; }
+    bool showOverlay = false;
+    const int phEvents = profiler.addPhase("events"), phUpdate = profiler.addPhase("update"), phCube = profiler.addPhase("cube"),
+              phSkybox = profiler.addPhase("skybox"), phOverlay = profiler.addPhase("overlay"), phSwap = profiler.addPhase("swap");
+
+    FramePacer pacer(fps); pacer.init(vsync);
+    // Frames are only drawn when something changed; the simulation announces every snapshot it publishes
+    bool dirty = true;
+    auto handleEvent = [&](SDL_Event& e) {
+        if (e.type == SDL_QUIT) running = false;
+        else if (e.type == SDL_WINDOWEVENT) dirty = true; // exposed, resized, restored: the old frame may be gone
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_i) { instancedDraw = !instancedDraw; dirty = true; }
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3) { showOverlay = !showOverlay; dirty = true; }
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F4) {
+            if (profiler.writeTrace(TRACE_FILE)) std::cerr << "Wrote " << TRACE_FILE << std::endl;
+            else std::cerr << "Could not write " << TRACE_FILE << std::endl;
+        }
+        else if (e.type == SDL_KEYDOWN || e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP || e.type == SDL_MOUSEMOTION || e.type == SDL_MOUSEWHEEL) {
+            InputEvent in = { e, false, -1, -1 };
+            if (idPicker && e.type == SDL_MOUSEBUTTONDOWN && e.button.button == 1) {
+                in.picked = true; // against the frame on screen, which is what the click was aimed at
+                if (!renderer.pick(sim.front(), *idPicker, e.button.x, e.button.y, in.cubie, in.face)) in.cubie = -1;
+            }
+            sim.post(in);
+        }
+    };
 
     while (running) {
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) running = false;
-            else cube.handleInput(event, rightDown, leftDown, lastX, lastY, clickStartX, clickStartY, pickedCubie, pickedFace, draggingCube);
+        // No new snapshot and nothing changed: sleep in the event queue (where the simulation's wake
+        // events arrive too) and leave the last frame on screen
+        if (!dirty && !textures.busy() && !ibl.baking()) {
+            if (SDL_WaitEventTimeout(&event, IDLE_WAIT_MS)) handleEvent(event);
+            dirty |= sim.takeSnapshot();
+            if (!dirty) continue;
         }
+        pacer.beginFrame();
+        profiler.beginFrame();
+        profiler.beginCpu(phEvents);
+        while (SDL_PollEvent(&event)) handleEvent(event);
+        profiler.endCpu(phEvents);
 
-        cube.update();
+        profiler.beginCpu(phUpdate);
+        sim.takeSnapshot(); // the newest, drawn below
+        textures.poll();
+        ibl.poll();
+        profiler.endCpu(phUpdate);
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glm::mat4 view, proj;
-        cube.getMatrices(view, proj);
-        cubeShader.use();
-        cube.draw(cubeShader);
+        const RenderSnapshot& snapshot = sim.front();
+        renderer.writeFrame(snapshot);
+        profiler.beginCpu(phCube); profiler.beginGpu(phCube);
+        if (instancedDraw) renderer.drawInstanced(snapshot, cubeShaders);
+        else renderer.draw(snapshot, cubeShaders);
+        profiler.endGpu(phCube); profiler.endCpu(phCube);
 
+        profiler.beginCpu(phSkybox); profiler.beginGpu(phSkybox);
         glDepthFunc(GL_LEQUAL);
         skyboxShader.use();
-        skyboxShader.setMat4("view", glm::mat4(glm::mat3(view))); 
-        skyboxShader.setMat4("projection", proj);
         glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
         skyboxMesh.draw();
         glDepthFunc(GL_LESS);
+        profiler.endGpu(phSkybox); profiler.endCpu(phSkybox);
+
+        if (showOverlay) {
+            profiler.beginCpu(phOverlay); profiler.beginGpu(phOverlay);
+            overlay.draw(profiler, WINDOW_WIDTH, WINDOW_HEIGHT);
+            profiler.endGpu(phOverlay); profiler.endCpu(phOverlay);
+        }
 
+        renderer.endFrame();
+        profiler.beginCpu(phSwap);
         SDL_GL_SwapWindow(window);
+        profiler.endCpu(phSwap);
+        profiler.endFrame();
+        dirty = false;
+        pacer.endFrame();
     }
+    sim.stop(); // before the recorder it writes to closes
+    profiler.releaseGpu(); textures.release(); frameUniforms.release(); idPicker.reset();
     SDL_GL_DeleteContext(context); SDL_DestroyWindow(window); SDL_Quit();
     return 0;
 }
\ No newline at end of file
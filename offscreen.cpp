@@ -0,0 +1,125 @@
+#include "offscreen.h"
+
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+bool OffscreenContext::init() {
+    // The surfaceless platform needs EGL_EXT_platform_base on the client side
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            std::cerr << "EGL Init Failed: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) { std::cerr << "EGL has no desktop OpenGL" << std::endl; release(); return false; }
+
+    // Everything is drawn into framebuffer objects, so any config will do, or none at all
+    const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = nullptr; EGLint configs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configs) || configs < 1) config = nullptr; // EGL_NO_CONFIG_KHR
+    const EGLint contextAttribs[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "EGL Context Create Failed: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::release() {
+    if (display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY; context = EGL_NO_CONTEXT;
+}
+
+bool RenderTarget::init(int w, int h, int samples) {
+    width = w; height = h;
+    GLint maxSize = 0; glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+    if (w > maxSize || h > maxSize) { std::cerr << "Offscreen size above this GPU's " << maxSize << " pixels" << std::endl; return false; }
+    GLint maxSamples = 0; glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    samples = std::min(samples, (int)maxSamples);
+    glGenFramebuffers(1, &fbo); glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &color); glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glGenRenderbuffers(1, &depth); glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glGenFramebuffers(1, &resolveFbo); glBindFramebuffer(GL_FRAMEBUFFER, resolveFbo);
+    glGenRenderbuffers(1, &resolved); glBindRenderbuffer(GL_RENDERBUFFER, resolved);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolved);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindRenderbuffer(GL_RENDERBUFFER, 0); glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void RenderTarget::bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void RenderTarget::resolve() {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo); glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFbo);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFbo);
+}
+
+void RenderTarget::release() {
+    if (fbo) { glDeleteFramebuffers(1, &fbo); glDeleteFramebuffers(1, &resolveFbo); }
+    if (color) { glDeleteRenderbuffers(1, &color); glDeleteRenderbuffers(1, &depth); glDeleteRenderbuffers(1, &resolved); }
+    fbo = resolveFbo = color = depth = resolved = 0;
+}
+
+void FrameReader::init(int w, int h) {
+    width = w; height = h; next = pending = 0;
+    glGenBuffers(2, pbos);
+    for (GLuint pbo : pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)w * h * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameReader::capture() {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[next]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // returns at once: the target is a buffer
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    next ^= 1; pending = std::min(pending + 1, 2);
+}
+
+bool FrameReader::take(std::vector<uint8_t>& pixels, bool drain) {
+    if (pending == 0 || (pending == 1 && !drain)) return false;
+    GLuint pbo = pbos[pending == 2 ? next : next ^ 1]; // the older of two is the one capture() fills next
+    const size_t bytes = (size_t)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    const void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+    if (src) { pixels.resize(bytes); std::memcpy(pixels.data(), src, bytes); glUnmapBuffer(GL_PIXEL_PACK_BUFFER); }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pending--;
+    return src != nullptr;
+}
+
+void FrameReader::release() {
+    if (pbos[0]) glDeleteBuffers(2, pbos);
+    pbos[0] = pbos[1] = 0; pending = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+// Rendering without a window or a display server: an EGL context with no surface at all, frames drawn
+// into a multisampled framebuffer object of any size, and read back through two pixel buffer objects
+// so that copying one frame out overlaps drawing the next instead of stalling on it.
+#include <GL/glew.h>
+#include <EGL/egl.h>
+
+#include <cstdint>
+#include <vector>
+
+class OffscreenContext {
+public:
+    OffscreenContext() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {}
+    ~OffscreenContext() { release(); }
+    OffscreenContext(const OffscreenContext&) = delete;
+    OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+    // A 3.3 core context made current on this thread, on the surfaceless platform when EGL has it
+    // (no X, Wayland or DRM master needed), else on the default display. False, with EGL's error on
+    // std::cerr, if neither works.
+    bool init();
+    void release();
+
+private:
+    EGLDisplay display; EGLContext context;
+};
+
+// Multisampled color and depth renderbuffers, resolved into a single-sample color buffer to read
+class RenderTarget {
+public:
+    int width, height;
+
+    RenderTarget() : width(0), height(0), fbo(0), resolveFbo(0), color(0), depth(0), resolved(0) {}
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    // GL: samples is capped at GL_MAX_SAMPLES; false if the framebuffer is incomplete at this size
+    bool init(int w, int h, int samples);
+    // GL: draws go to the target from here on, with the viewport covering all of it
+    void bind();
+    // GL: resolves the samples; the resolved image is then the bound GL_READ_FRAMEBUFFER
+    void resolve();
+    void release();
+
+private:
+    GLuint fbo, resolveFbo, color, depth, resolved;
+};
+
+// Frame k is copied into one buffer by the GPU on its own time and only mapped once frame k+1 has
+// been captured into the other, by which point the copy has long finished.
+class FrameReader {
+public:
+    FrameReader() : width(0), height(0), next(0), pending(0), pbos{} {}
+    FrameReader(const FrameReader&) = delete;
+    FrameReader& operator=(const FrameReader&) = delete;
+
+    // GL: two buffers of width x height RGBA8
+    void init(int w, int h);
+    // GL: starts copying the bound read framebuffer into the next buffer. Call take() first if
+    // both buffers are still pending, or the older frame is lost.
+    void capture();
+    // GL: the oldest capture not yet taken, as RGBA8 rows bottom row first (as GL stores them).
+    // Only while the newer buffer is still in flight, unless drain is set (after the last frame).
+    bool take(std::vector<uint8_t>& pixels, bool drain = false);
+    void release();
+
+private:
+    int width, height;
+    int next, pending; // buffer capture() fills next; captures not yet taken
+    GLuint pbos[2];
+};
@@ -0,0 +1,131 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const double SMOOTHING = 0.05; // weight of the newest sample in the per-phase averages
+const float BUCKET_MS = 0.25f;
+}
+
+Profiler::Profiler() : epoch(Clock::now()), queriesReady(false), frameCount(0), frameIndex(0), recorded(0) {
+    std::memset(cpuStart, 0, sizeof(cpuStart)); std::memset(gpuIssue, 0, sizeof(gpuIssue));
+    std::memset(cpuAverage, 0, sizeof(cpuAverage)); std::memset(gpuAverage, 0, sizeof(gpuAverage));
+    std::memset(queries, 0, sizeof(queries)); std::memset(issued, 0, sizeof(issued));
+    std::memset(histogram, 0, sizeof(histogram));
+    for (int s = 0; s < QUERY_SETS; s++) queryFrame[s] = -1;
+    for (Frame& f : frames) { f.startUs = 0; f.frameMs = 0; f.events.reserve(2 * MAX_PHASES); }
+}
+
+void Profiler::initGpu() {
+    if (queriesReady) return;
+    glGenQueries(QUERY_SETS * MAX_PHASES, &queries[0][0]);
+    queriesReady = true;
+}
+
+void Profiler::releaseGpu() {
+    if (!queriesReady) return;
+    glDeleteQueries(QUERY_SETS * MAX_PHASES, &queries[0][0]);
+    std::memset(issued, 0, sizeof(issued));
+    queriesReady = false;
+}
+
+int Profiler::addPhase(const char* name) {
+    if ((int)phases.size() >= MAX_PHASES) return MAX_PHASES - 1;
+    phases.push_back(name);
+    return (int)phases.size() - 1;
+}
+
+int Profiler::bucket(float ms) { return std::min(BUCKETS - 1, std::max(0, (int)(ms / BUCKET_MS))); }
+
+void Profiler::beginFrame() {
+    Frame& f = frames[frameIndex];
+    if (recorded == HISTORY) histogram[bucket(f.frameMs)]--;
+    f.events.clear();
+    f.startUs = nowUs();
+    int set = (int)(frameCount % QUERY_SETS);
+    if (queriesReady) collectGpu(set);
+    queryFrame[set] = frameCount;
+}
+
+void Profiler::endFrame() {
+    Frame& f = frames[frameIndex];
+    f.frameMs = (float)((nowUs() - f.startUs) / 1000.0);
+    histogram[bucket(f.frameMs)]++;
+    frameIndex = (frameIndex + 1) % HISTORY;
+    recorded = std::min(recorded + 1, HISTORY);
+    frameCount++;
+}
+
+void Profiler::beginCpu(int id) { cpuStart[id] = nowUs(); }
+
+void Profiler::endCpu(int id) {
+    double end = nowUs(), ms = (end - cpuStart[id]) / 1000.0;
+    cpuAverage[id] += (ms - cpuAverage[id]) * SMOOTHING;
+    frames[frameIndex].events.push_back({ id, false, cpuStart[id], end - cpuStart[id] });
+}
+
+void Profiler::beginGpu(int id) {
+    if (!queriesReady) return;
+    int set = (int)(frameCount % QUERY_SETS);
+    glBeginQuery(GL_TIME_ELAPSED, queries[set][id]);
+    gpuIssue[set][id] = nowUs();
+    issued[set][id] = true;
+}
+
+void Profiler::endGpu(int id) {
+    if (!queriesReady || !issued[frameCount % QUERY_SETS][id]) return;
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+// Reads the queries this set issued QUERY_SETS frames ago. A result that is still pending is
+// dropped rather than waited for, so profiling never blocks the frame.
+void Profiler::collectGpu(int set) {
+    long age = frameCount - queryFrame[set];
+    for (int id = 0; id < MAX_PHASES; id++) {
+        if (!issued[set][id]) continue;
+        issued[set][id] = false;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[set][id], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[set][id], GL_QUERY_RESULT, &ns);
+        double ms = ns / 1e6;
+        gpuAverage[id] += (ms - gpuAverage[id]) * SMOOTHING;
+        // Elapsed-time queries carry no start time; the trace places them where the CPU issued them
+        if (queryFrame[set] >= 0 && age < HISTORY)
+            frames[(frameIndex + HISTORY - age) % HISTORY].events.push_back({ id, true, gpuIssue[set][id], ns / 1e3 });
+    }
+}
+
+double Profiler::frameMeanMs() const {
+    if (!recorded) return 0;
+    double sum = 0;
+    for (int i = 0; i < recorded; i++) sum += frameHistory(i);
+    return sum / recorded;
+}
+
+double Profiler::framePercentileMs(double p) const {
+    if (!recorded) return 0;
+    int target = std::max(1, (int)(p * recorded + 0.999)), seen = 0;
+    for (int b = 0; b < BUCKETS; b++) if ((seen += histogram[b]) >= target) return (b + 1) * BUCKET_MS;
+    return BUCKETS * BUCKET_MS;
+}
+
+bool Profiler::writeTrace(const std::string& path) const {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+    std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    for (int age = recorded - 1; age >= 0; age--) {
+        const Frame& fr = frames[(frameIndex + 2 * HISTORY - 1 - age) % HISTORY];
+        std::fprintf(f, ",\n{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f}", fr.startUs, fr.frameMs * 1000.0);
+        for (const Event& e : fr.events)
+            std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.1f,\"dur\":%.1f}",
+                         phases[e.phase].c_str(), e.gpu ? 2 : 1, e.startUs, e.durationUs);
+    }
+    std::fprintf(f, "\n]}\n");
+    return std::fclose(f) == 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+// Frame profiler: CPU time per phase, GPU time per phase from GL_TIME_ELAPSED queries, a rolling
+// frame-time histogram, and Chrome trace export of the recorded frames.
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class Profiler {
+public:
+    static const int HISTORY = 240;    // frames kept for statistics and the trace
+    static const int MAX_PHASES = 8;
+    static const int QUERY_SETS = 2;   // GPU queries are read back one frame late, so they never stall
+    static const int BUCKETS = 400;    // histogram of frame times, 0.25 ms per bucket, last one is overflow
+
+    Profiler();
+    // Query objects need a current GL context; the CPU side works without one
+    void initGpu();
+    void releaseGpu();
+
+    // Phases are registered once; the id is then used for timing calls
+    int addPhase(const char* name);
+    const std::string& phaseName(int id) const { return phases[id]; }
+    int phaseCount() const { return (int)phases.size(); }
+
+    void beginFrame();
+    void endFrame();
+    void beginCpu(int id);
+    void endCpu(int id);
+    // GL_TIME_ELAPSED cannot nest, so GPU phases must not overlap
+    void beginGpu(int id);
+    void endGpu(int id);
+
+    // Statistics over the last HISTORY frames, in milliseconds
+    double frameMs() const { return frames[(frameIndex + HISTORY - 1) % HISTORY].frameMs; }
+    double frameMeanMs() const;
+    double framePercentileMs(double p) const;
+    double cpuMs(int id) const { return cpuAverage[id]; }
+    double gpuMs(int id) const { return gpuAverage[id]; }
+    bool gpuAvailable() const { return queriesReady; }
+    // Frame time of the frame `age` frames ago (0 = last finished one), for graphs
+    float frameHistory(int age) const { return frames[(frameIndex + 2 * HISTORY - 1 - age) % HISTORY].frameMs; }
+    int recordedFrames() const { return recorded; }
+
+    // Chrome trace (chrome://tracing, Perfetto) of the recorded frames; CPU on tid 1, GPU on tid 2
+    bool writeTrace(const std::string& path) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    struct Event { int phase; bool gpu; double startUs, durationUs; };
+    struct Frame { double startUs; float frameMs; std::vector<Event> events; };
+
+    std::vector<std::string> phases;
+    Clock::time_point epoch;
+    double cpuStart[MAX_PHASES], gpuIssue[QUERY_SETS][MAX_PHASES];
+    double cpuAverage[MAX_PHASES], gpuAverage[MAX_PHASES];
+    GLuint queries[QUERY_SETS][MAX_PHASES];
+    bool issued[QUERY_SETS][MAX_PHASES];
+    long queryFrame[QUERY_SETS];
+    bool queriesReady;
+    Frame frames[HISTORY];
+    int histogram[BUCKETS];
+    long frameCount; int frameIndex, recorded;
+
+    double nowUs() const { return std::chrono::duration<double, std::micro>(Clock::now() - epoch).count(); }
+    static int bucket(float ms);
+    void collectGpu(int set);
+};
@@ -0,0 +1,129 @@
+// Headless front end to librubik: scramble, apply and solve over stdin/stdout.
+#include "batch_solver.h"
+#include "cube_nxn.h"
+#include "cube_state.h"
+#include "scramble.h"
+#include "session_log.h"
+#include "solver.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t SOLVE_BLOCK = 4096; // lines solved (or scrambles generated) per batch, so output streams on long inputs
+
+int usage() {
+    std::cerr << "Usage: rubik_cli <command>\n"
+                 "  scramble [length] [count] [seed]  print scrambles, 1 by default: random-state for length 0 (the\n"
+                 "                                    default), else random moves without cancelling turns\n"
+                 "  apply                             for each stdin line of moves, print the facelets of the result\n"
+                 "  solve [maxLength] [seconds]       for each stdin line of moves, print a solution (or 'error'); with\n"
+                 "                                    seconds, the shortest one an optimal search finds in that time\n"
+                 "  replay <file>...                  replay recorded sessions: per file, cube size, turns, scrambles,\n"
+                 "                                    seconds and whether it ended solved\n"
+                 "  tables                            build the solver table cache, including the optimal-search table\n";
+    return 1;
+}
+
+int scramble(int argc, char* argv[]) {
+    int length = argc > 2 ? std::atoi(argv[2]) : 0;
+    uint64_t count = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+    uint64_t seed = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : (uint64_t)std::time(nullptr);
+    ScrambleGenerator generator;
+    BatchSolutions scrambles;
+    std::vector<MoveType> moves;
+    int status = 0;
+    for (uint64_t first = 0; first < count; first += SOLVE_BLOCK) {
+        size_t block = (size_t)std::min<uint64_t>(SOLVE_BLOCK, count - first);
+        generator.generate(seed, first, block, length > 0 ? SCRAMBLE_RANDOM_MOVES : SCRAMBLE_RANDOM_STATE, scrambles, length);
+        for (size_t i = 0; i < block; i++) {
+            if (!scrambles.solved(i)) { std::cout << "error\n"; status = 2; continue; }
+            scrambles.copy(i, moves);
+            std::cout << formatMoves(moves.data(), moves.size()) << '\n';
+        }
+        std::cout.flush();
+    }
+    return status;
+}
+
+int apply() {
+    std::string line; std::vector<MoveType> moves;
+    int status = 0;
+    while (std::getline(std::cin, line)) {
+        moves.clear();
+        if (!parseMoves(line, moves)) { std::cout << "error\n"; status = 2; continue; }
+        CubeState s; s.apply(moves.data(), (int)moves.size());
+        std::cout << s.facelets() << '\n';
+    }
+    return status;
+}
+
+int solve(int argc, char* argv[]) {
+    int maxLength = argc > 2 ? std::atoi(argv[2]) : 22;
+    double timeBudget = argc > 3 ? std::atof(argv[3]) : 0.0;
+    BatchSolver solver;
+    BatchSolutions solutions;
+    std::vector<std::vector<MoveType>> block;
+    std::vector<char> parsed;
+    std::vector<MoveType> moves;
+    std::string line;
+    int status = 0;
+    bool more = true;
+    while (more) {
+        block.clear(); parsed.clear();
+        while (block.size() < SOLVE_BLOCK && (more = (bool)std::getline(std::cin, line))) {
+            block.emplace_back();
+            parsed.push_back(parseMoves(line, block.back()));
+        }
+        solver.solveSequences(block, solutions, maxLength, timeBudget);
+        for (size_t i = 0; i < block.size(); i++) {
+            if (!parsed[i] || !solutions.solved(i)) { std::cout << "error\n"; status = 2; continue; }
+            solutions.copy(i, moves);
+            optimizeMoves(moves);
+            std::cout << formatMoves(moves.data(), moves.size()) << '\n';
+        }
+        std::cout.flush();
+    }
+    return status;
+}
+
+int replay(int argc, char* argv[]) {
+    int status = 0;
+    std::vector<LayerTurn> turns;
+    for (int i = 2; i < argc; i++) {
+        SessionReader session;
+        if (!session.open(argv[i])) { std::cout << argv[i] << " error\n"; status = 2; continue; }
+        Xoshiro256 rng(session.sessionSeed()); // scrambles come from the seed, as in the game
+        CubeNxN cube(session.cubeSize());
+        SessionEvent e; uint64_t turnCount = 0, scrambles = 0, ms = 0;
+        while (session.next(e)) {
+            ms = e.ms;
+            if (e.kind == SessionEvent::TURN) { cube.turn(e.turn); turnCount++; continue; }
+            turns.clear(); scrambleTurns(cube.size(), rng, turns);
+            for (const LayerTurn& t : turns) cube.turn(t);
+            scrambles++;
+        }
+        std::cout << argv[i] << ' ' << cube.size() << ' ' << turnCount << ' ' << scrambles << ' ' << ms / 1000.0 << ' '
+                  << (cube.isSolved() ? "solved" : "unsolved") << '\n';
+    }
+    return status;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+    if (argc < 2) return usage();
+    if (std::strcmp(argv[1], "scramble") == 0) return scramble(argc, argv);
+    if (std::strcmp(argv[1], "apply") == 0) return apply();
+    if (std::strcmp(argv[1], "solve") == 0) return solve(argc, argv);
+    if (std::strcmp(argv[1], "replay") == 0) return replay(argc, argv);
+    if (std::strcmp(argv[1], "tables") == 0) { solverTables().ensureCornerPrune(); return 0; }
+    return usage();
+}
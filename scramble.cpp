@@ -0,0 +1,124 @@
+#include "scramble.h"
+
+#include <algorithm>
+
+namespace {
+
+const size_t MOVE_GRAIN = 4096; // random-move scrambles take well under a microsecond each
+
+// Fisher-Yates; returns the permutation's parity
+template <int N> int shuffle(Xoshiro256& rng, uint8_t (&p)[N]) {
+    int parity = 0;
+    for (int i = 0; i < N; i++) p[i] = (uint8_t)i;
+    for (int i = N - 1; i > 0; i--) {
+        int j = (int)rng.below((uint32_t)i + 1);
+        if (j != i) { std::swap(p[i], p[j]); parity ^= 1; }
+    }
+    return parity;
+}
+
+// The sequence undoing moves[0 .. count-1], in place
+template <typename Move> void invert(Move* moves, size_t count) {
+    std::reverse(moves, moves + count);
+    for (size_t i = 0; i < count; i++) moves[i] = (Move)inverseMove((MoveType)moves[i]);
+}
+
+template <typename Move> void writeRandomMoves(Xoshiro256& rng, Move* out, size_t length) {
+    int lastFace = -1;
+    for (size_t i = 0; i < length;) {
+        int face = (int)rng.below(6), power = (int)rng.below(3); // faces in MoveType order: F B L R U D
+        // Opposite faces are 2k, 2k+1: after the odd one only another axis may follow
+        if (lastFace >= 0 && (face == lastFace || (face / 2 == lastFace / 2 && face < lastFace))) continue;
+        out[i++] = (Move)(power == 2 ? MOVE_F2 + face : 2 * face + power);
+        lastFace = face;
+    }
+}
+
+} // namespace
+
+CubeState randomState(Xoshiro256& rng) {
+    CubeState s;
+    int parity = shuffle(rng, s.cp) ^ shuffle(rng, s.ep);
+    if (parity) std::swap(s.ep[10], s.ep[11]); // only even total permutations are reachable
+    int twist = 0, flip = 0;
+    for (int i = 0; i < 7; i++) { s.co[i] = (uint8_t)rng.below(3); twist += s.co[i]; }
+    s.co[7] = (uint8_t)((3 - twist % 3) % 3);
+    for (int i = 0; i < 11; i++) { s.eo[i] = (uint8_t)rng.below(2); flip += s.eo[i]; }
+    s.eo[11] = (uint8_t)(flip & 1);
+    return s;
+}
+
+bool randomStateScramble(Solver& solver, Xoshiro256& rng, std::vector<MoveType>& out, int maxLength) {
+    if (!solver.solve(randomState(rng), out, maxLength)) return false;
+    invert(out.data(), out.size());
+    return true;
+}
+
+void randomMoveScramble(Xoshiro256& rng, int length, std::vector<MoveType>& out) {
+    out.resize(std::max(0, length));
+    writeRandomMoves(rng, out.data(), out.size());
+}
+
+void scrambleTurns(int size, Xoshiro256& rng, std::vector<LayerTurn>& out) {
+    if (size != 3) { randomTurns(rng, size, 10 * size, out); return; }
+    Solver solver;
+    std::vector<MoveType> moves;
+    randomStateScramble(solver, rng, moves);
+    for (MoveType m : moves) out.push_back(layerTurn(m, size));
+}
+
+void ScrambleGenerator::generate(uint64_t seed, uint64_t first, size_t count, ScrambleKind kind, BatchSolutions& out, int length) {
+    if (kind == SCRAMBLE_RANDOM_STATE) {
+        states.resize(count);
+        for (size_t i = 0; i < count; i++) { Xoshiro256 rng(seed, first + i); states[i] = randomState(rng); }
+        solver.solve(states, out);
+        for (size_t i = 0; i < count; i++) invert(&out.moves[i * BatchSolutions::MAX_MOVES], (size_t)out.length(i));
+        return;
+    }
+    length = std::min(std::max(length, 0), BatchSolutions::MAX_MOVES);
+    out.moves.resize(count * BatchSolutions::MAX_MOVES);
+    out.lengths.assign(count, (int8_t)length);
+    pool.parallelFor(count, MOVE_GRAIN, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) { Xoshiro256 rng(seed, first + i); writeRandomMoves(rng, &out.moves[i * BatchSolutions::MAX_MOVES], (size_t)length); }
+    });
+}
+
+ScrambleQueue::ScrambleQueue(uint64_t seed, SolverTables* solverTables, ThreadPool* threadPool) : rng(seed), tables(solverTables), pool(threadPool), quit(false) {
+    worker = std::thread(&ScrambleQueue::run, this);
+}
+
+ScrambleQueue::~ScrambleQueue() {
+    { std::lock_guard<std::mutex> lock(mutex); quit = true; }
+    changed.notify_all();
+    worker.join();
+}
+
+bool ScrambleQueue::next(std::vector<MoveType>& out, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (wait) changed.wait(lock, [this] { return !ready.empty(); });
+    if (ready.empty()) return false;
+    out.swap(ready.front()); ready.pop_front();
+    if (ready.size() == BATCH) changed.notify_all(); // room for another batch
+    return true;
+}
+
+// Keeps up to two batches ready: one being taken from, the next already solved behind it
+void ScrambleQueue::run() {
+    std::unique_ptr<BatchSolver> solver;
+    std::vector<CubeState> states(BATCH);
+    BatchSolutions solutions;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        changed.wait(lock, [this] { return quit || ready.size() <= BATCH; });
+        if (quit) return;
+        lock.unlock();
+        if (!solver) solver.reset(new BatchSolver(tables ? *tables : solverTables(), pool ? *pool : sharedThreadPool()));
+        for (CubeState& s : states) s = randomState(rng); // in order, as scrambleTurns() draws them
+        solver->solve(states, solutions);
+        std::vector<std::vector<MoveType>> batch(BATCH);
+        for (size_t i = 0; i < BATCH; i++) { solutions.copy(i, batch[i]); invert(batch[i].data(), batch[i].size()); }
+        lock.lock();
+        for (std::vector<MoveType>& moves : batch) ready.push_back(std::move(moves));
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+// Scrambles from Xoshiro256: random-state ones (a uniformly random cube, solved, the solution
+// inverted), the kind competitions use, and cheaper random-move ones without redundant turns.
+#include "batch_solver.h"
+#include "cube_nxn.h"
+#include "xoshiro.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Uniform over the reachable 3x3x3 states with the centers in place
+CubeState randomState(Xoshiro256& rng);
+// A face-turn sequence taking the solved cube to a random state; false only if the solver fails
+bool randomStateScramble(Solver& solver, Xoshiro256& rng, std::vector<MoveType>& out, int maxLength = 22);
+// length face turns (quarter or half), never the same face twice in a row and opposite faces in one
+// order only, so nothing cancels or collapses (no R R', no R L R)
+void randomMoveScramble(Xoshiro256& rng, int length, std::vector<MoveType>& out);
+// What the game's scramble does to a size-N cube: a random-state scramble on the 3x3x3, 10 random
+// layer turns per layer count on other sizes. Recorded sessions replay scrambles through this.
+void scrambleTurns(int size, Xoshiro256& rng, std::vector<LayerTurn>& out);
+
+enum ScrambleKind { SCRAMBLE_RANDOM_STATE, SCRAMBLE_RANDOM_MOVES };
+
+// Bulk scrambles spread over a thread pool. Scramble i of a seed uses Xoshiro256(seed, i) alone, so
+// any range of indices gives the same scrambles however it is split across threads, calls or processes.
+class ScrambleGenerator {
+public:
+    explicit ScrambleGenerator(SolverTables& tables = solverTables(), ThreadPool& threadPool = sharedThreadPool()) : pool(threadPool), solver(tables, threadPool) {}
+
+    // Scrambles first .. first+count-1 into out (random-move ones of length moves, at most
+    // BatchSolutions::MAX_MOVES); a random-state scramble the solver misses stays unsolved in out
+    void generate(uint64_t seed, uint64_t first, size_t count, ScrambleKind kind, BatchSolutions& out, int length = 20);
+
+private:
+    ThreadPool& pool;
+    BatchSolver solver;
+    std::vector<CubeState> states;
+};
+
+// The 3x3x3 scrambles scrambleTurns() makes from Xoshiro256(seed), in the same order, solved ahead
+// in batches on a background thread so taking one never waits on a solve. The first batch starts
+// at construction, which is also when the tables are first touched (loaded or built) on that thread.
+class ScrambleQueue {
+public:
+    static const size_t BATCH = 64; // scrambles per batch; the next is solved while one is still left
+
+    // nullptr for solverTables() and sharedThreadPool()
+    explicit ScrambleQueue(uint64_t seed, SolverTables* tables = nullptr, ThreadPool* pool = nullptr);
+    ~ScrambleQueue(); // waits for the batch being solved
+    ScrambleQueue(const ScrambleQueue&) = delete;
+    ScrambleQueue& operator=(const ScrambleQueue&) = delete;
+
+    // The next scramble, as face turns from solved; false if it isn't solved yet, unless wait is set
+    bool next(std::vector<MoveType>& out, bool wait = false);
+
+private:
+    Xoshiro256 rng; SolverTables* tables; ThreadPool* pool; // worker only
+    std::thread worker;
+    std::mutex mutex; std::condition_variable changed; // guard ready and quit
+    std::deque<std::vector<MoveType>> ready; bool quit;
+
+    void run();
+};
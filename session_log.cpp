@@ -0,0 +1,164 @@
+#include "session_log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Header bytes: magic, version, cube size, two reserved zeros, then the seed little-endian
+const size_t HEADER_BYTES = 16, SEED_OFFSET = 8;
+const char MAGIC[4] = { 'R', 'B', 'K', 'S' };
+const uint8_t VERSION = 2; // 2: scrambles from Xoshiro256 instead of rand()
+
+// 5-bit event codes past the MoveTypes
+const unsigned SESSION_SCRAMBLE = 30, SESSION_LAYER_TURN = 31, CODE_BITS = 5;
+const size_t MAX_BLOCK_EVENTS = 1 << 16; // a larger count can only come from a damaged file
+
+struct BitWriter {
+    std::vector<uint8_t> bytes; unsigned used = 8; // bits used in the last byte
+    void put(unsigned value, unsigned bits) {
+        for (unsigned i = 0; i < bits; i++) {
+            if (used == 8) { bytes.push_back(0); used = 0; }
+            bytes.back() |= (uint8_t)(((value >> i) & 1) << used++);
+        }
+    }
+};
+
+struct BitReader {
+    const uint8_t* data; size_t size, bit;
+    // false once past the end
+    bool get(unsigned bits, unsigned& value) {
+        if (bit + bits > size * 8) return false;
+        value = 0;
+        for (unsigned i = 0; i < bits; i++, bit++) value |= (unsigned)((data[bit / 8] >> (bit % 8)) & 1) << i;
+        return true;
+    }
+};
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    for (; v >= 0x80; v >>= 7) out.push_back((uint8_t)(v | 0x80));
+    out.push_back((uint8_t)v);
+}
+
+bool getVarint(FILE* f, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = std::fgetc(f);
+        if (c == EOF) return false;
+        v |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// -1, 1 or 2 (a half turn either way)
+int normalizeTurn(int q) { q = ((q % 4) + 4) % 4; return q == 3 ? -1 : q; }
+
+void putTurn(BitWriter& bits, int size, const LayerTurn& t) {
+    int q = normalizeTurn(t.quarterTurns);
+    for (int m = 0; m < MOVE_NONE; m++) {
+        LayerTurn named = layerTurn((MoveType)m, size);
+        if (named.quarterTurns && named.axis == t.axis && named.layer == t.layer && named.quarterTurns == q) { bits.put((unsigned)m, CODE_BITS); return; }
+    }
+    bits.put(SESSION_LAYER_TURN, CODE_BITS);
+    bits.put((unsigned)t.axis, 2); bits.put((unsigned)t.layer, 5); bits.put(q < 0 ? 0 : (unsigned)q, 2);
+}
+
+bool getEvent(BitReader& bits, int size, SessionEvent& e) {
+    unsigned code;
+    if (!bits.get(CODE_BITS, code)) return false;
+    e.turn = { 0, 0, 0 };
+    if (code == SESSION_SCRAMBLE) { e.kind = SessionEvent::SCRAMBLE; return true; }
+    e.kind = SessionEvent::TURN;
+    if (code < MOVE_NONE) { e.turn = layerTurn((MoveType)code, size); return e.turn.quarterTurns != 0; }
+    unsigned axis, layer, q;
+    if (code != SESSION_LAYER_TURN || !bits.get(2, axis) || !bits.get(5, layer) || !bits.get(2, q)) return false;
+    if (axis > 2 || (int)layer >= size || q > 2) return false;
+    e.turn = { (int)axis, (int)layer, q == 0 ? -1 : (int)q };
+    return true;
+}
+
+} // namespace
+
+bool SessionWriter::open(const std::string& path, int cubeSize, uint64_t seed) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    uint8_t h[HEADER_BYTES] = {};
+    std::memcpy(h, MAGIC, sizeof(MAGIC)); h[4] = VERSION; h[5] = (uint8_t)cubeSize;
+    for (int i = 0; i < 8; i++) h[SEED_OFFSET + i] = (uint8_t)(seed >> (8 * i));
+    if (std::fwrite(h, 1, HEADER_BYTES, file) != HEADER_BYTES) { std::fclose(file); file = nullptr; return false; }
+    size = cubeSize; lastMs = 0; pending.clear(); pending.reserve(BLOCK_EVENTS);
+    return true;
+}
+
+void SessionWriter::add(const SessionEvent& e) {
+    if (!file) return;
+    pending.push_back(e);
+    if (pending.size() >= BLOCK_EVENTS) flush();
+}
+
+bool SessionWriter::flush() {
+    if (pending.empty()) return true;
+    BitWriter bits;
+    for (const SessionEvent& e : pending) {
+        if (e.kind == SessionEvent::SCRAMBLE) bits.put(SESSION_SCRAMBLE, CODE_BITS);
+        else putTurn(bits, size, e.turn);
+    }
+    std::vector<uint8_t> out;
+    putVarint(out, pending.size()); putVarint(out, bits.bytes.size());
+    out.insert(out.end(), bits.bytes.begin(), bits.bytes.end());
+    for (const SessionEvent& e : pending) { putVarint(out, e.ms >= lastMs ? e.ms - lastMs : 0); lastMs = std::max(lastMs, e.ms); }
+    pending.clear();
+    // One write per block; fflush so another process (or a crash) sees every finished block
+    return std::fwrite(out.data(), 1, out.size(), file) == out.size() && std::fflush(file) == 0;
+}
+
+void SessionWriter::close() {
+    if (!file) return;
+    flush();
+    std::fclose(file);
+    file = nullptr;
+}
+
+bool SessionReader::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    uint8_t h[HEADER_BYTES];
+    if (std::fread(h, 1, HEADER_BYTES, file) != HEADER_BYTES || std::memcmp(h, MAGIC, sizeof(MAGIC)) != 0 || h[4] != VERSION ||
+        h[5] < CUBE_MIN_SIZE || h[5] > CUBE_MAX_SIZE) { close(); return false; }
+    size = h[5]; seed = 0; lastMs = 0;
+    for (int i = 0; i < 8; i++) seed |= (uint64_t)h[SEED_OFFSET + i] << (8 * i);
+    return true;
+}
+
+void SessionReader::close() {
+    if (file) std::fclose(file);
+    file = nullptr; block.clear(); cursor = 0;
+}
+
+bool SessionReader::readBlock() {
+    block.clear(); cursor = 0;
+    uint64_t count, length;
+    if (!getVarint(file, count) || !getVarint(file, length)) return false;
+    if (count == 0 || count > MAX_BLOCK_EVENTS || length > count * 2) return false; // at most 14 bits an event
+    std::vector<uint8_t> packed((size_t)length);
+    if (std::fread(packed.data(), 1, packed.size(), file) != packed.size()) return false;
+    BitReader bits = { packed.data(), packed.size(), 0 };
+    block.resize((size_t)count);
+    for (SessionEvent& e : block) if (!getEvent(bits, size, e)) { block.clear(); return false; }
+    for (SessionEvent& e : block) {
+        uint64_t delta;
+        if (!getVarint(file, delta)) { block.clear(); return false; }
+        e.ms = lastMs += delta;
+    }
+    return true;
+}
+
+bool SessionReader::next(SessionEvent& e) {
+    if (!file) return false;
+    if (cursor == block.size() && !readBlock()) return false;
+    e = block[cursor++];
+    return true;
+}
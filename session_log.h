@@ -0,0 +1,69 @@
+#pragma once
+// Recorded play sessions: every turn and scramble with its time, streamed to and from disk in small
+// blocks, so neither a long session nor a large archive of them is ever held in memory.
+//
+// File: a 16-byte header (magic "RBKS", version, cube size, two zero bytes, then the scramble seed as
+// 8 bytes little-endian), then blocks up to the end of the file. A block is a varint event count, the
+// varint byte length of its packed turns, the turns as a bit stream (least significant bit first),
+// and one varint per event of milliseconds since the previous event (the first: since the
+// previous block's last event, or the session start).
+// An event is 5 bits: a MoveType, SESSION_SCRAMBLE, or SESSION_LAYER_TURN followed by 2 bits axis,
+// 5 bits layer and 2 bits turn (0: -1, 1: +1, 2: half) for layers without a move name (the inner
+// layers of cubes above 3x3x3). Scrambles are not stored move by move: a replay regenerates them in
+// order with scrambleTurns() (scramble.h) from one Xoshiro256 seeded with the header's seed.
+#include "cube_nxn.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct SessionEvent {
+    enum Kind { TURN, SCRAMBLE } kind;
+    LayerTurn turn; // TURN only
+    uint64_t ms; // since the session start
+};
+
+class SessionWriter {
+public:
+    static const size_t BLOCK_EVENTS = 256; // events buffered per block (and per write to the file)
+
+    SessionWriter() : file(nullptr), size(0), lastMs(0) {}
+    ~SessionWriter() { close(); }
+    SessionWriter(const SessionWriter&) = delete;
+    SessionWriter& operator=(const SessionWriter&) = delete;
+
+    // Creates (or truncates) path and writes the header; false if it can't be written
+    bool open(const std::string& path, int cubeSize, uint64_t seed);
+    bool isOpen() const { return file != nullptr; }
+    // Events must come in time order; a full block goes to the file right away
+    void add(const SessionEvent& e);
+    // Writes the partial block; a session cut short loses at most one block
+    void close();
+
+private:
+    FILE* file; int size; uint64_t lastMs;
+    std::vector<SessionEvent> pending;
+    bool flush();
+};
+
+class SessionReader {
+public:
+    SessionReader() : file(nullptr), size(0), seed(0), lastMs(0), cursor(0) {}
+    ~SessionReader() { close(); }
+    SessionReader(const SessionReader&) = delete;
+    SessionReader& operator=(const SessionReader&) = delete;
+
+    // False if path is missing or not a session of a supported version and cube size
+    bool open(const std::string& path);
+    void close();
+    int cubeSize() const { return size; }
+    uint64_t sessionSeed() const { return seed; }
+    // The next event, reading the next block when needed; false at the end (or at a damaged block)
+    bool next(SessionEvent& e);
+
+private:
+    FILE* file; int size; uint64_t seed, lastMs;
+    std::vector<SessionEvent> block; size_t cursor; // events of the current block, the next one to return
+    bool readBlock();
+};
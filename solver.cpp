@@ -0,0 +1,494 @@
+#include "solver.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const MoveType faceMoveType[6] = { MOVE_U, MOVE_R, MOVE_F, MOVE_D, MOVE_L, MOVE_B };
+const int allMoves[N_FACEMOVES] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17 };
+// U, U2, U', D, D2, D', R2, F2, L2, B2
+const int phase2Moves[10] = { 0, 1, 2, 9, 10, 11, 4, 7, 13, 16 };
+
+bool isPhase2Move(int m) { int f = m / 3; return f == 0 || f == 3 || m % 3 == 1; }
+// Skip turns of the same face twice in a row, and only allow opposite faces in one order (U before D, ...)
+bool redundant(int face, int lastFace) { return lastFace >= 0 && (face == lastFace || face == lastFace - 3); }
+
+// Optimal-search nodes with at least this many turns to go look up and record transpositions. Below it
+// the probe (a symmetry reduction, ~1 us, and a cache miss) costs more than the rare hit saves;
+// above it the table is what lets a repeated or symmetric state skip the search.
+const int TRANSPOSITION_DEPTH = 9;
+
+int twistCoord(const CubeState& s) { int r = 0; for (int i = 0; i < 7; i++) r = r * 3 + s.co[i]; return r; }
+int flipCoord(const CubeState& s) { int r = 0; for (int i = 0; i < 11; i++) r = r * 2 + s.eo[i]; return r; }
+
+int binom(int n, int k) {
+    if (k < 0 || k > n) return 0;
+    int r = 1; for (int i = 0; i < k; i++) r = r * (n - i) / (i + 1);
+    return r;
+}
+
+// Which slots hold the FR/FL/BL/BR edges, 0 when they are in the middle layer
+int sliceCoord(const CubeState& s) {
+    int r = 0, x = 0;
+    for (int j = 11; j >= 0; j--) if (s.ep[j] >= 8) { r += binom(11 - j, x + 1); x++; }
+    return r;
+}
+
+template <int N>
+int permRank(const uint8_t* p) {
+    int r = 0;
+    for (int i = 0; i < N; i++) { int smaller = 0; for (int j = i + 1; j < N; j++) if (p[j] < p[i]) smaller++; r = r * (N - i) + smaller; }
+    return r;
+}
+
+// Inverse of permRank
+template <int N>
+void permUnrank(int r, uint8_t* p) {
+    int digits[N]; bool used[N] = {};
+    for (int i = N - 1; i >= 0; i--) { digits[i] = r % (N - i); r /= N - i; }
+    for (int i = 0; i < N; i++)
+        for (int v = 0, k = digits[i]; v < N; v++) if (!used[v] && k-- == 0) { p[i] = (uint8_t)v; used[v] = true; break; }
+}
+
+int cpermCoord(const CubeState& s) { return permRank<8>(s.cp); }
+int udpermCoord(const CubeState& s) { return permRank<8>(s.ep); }
+int spermCoord(const CubeState& s) { return permRank<4>(s.ep + 8); }
+
+CubeState cpermState(int c) { CubeState s; permUnrank<8>(c, s.cp); return s; }
+CubeState twistState(int t) {
+    CubeState s; int sum = 0;
+    for (int i = 6; i >= 0; i--) { s.co[i] = (uint8_t)(t % 3); sum += s.co[i]; t /= 3; }
+    s.co[7] = (uint8_t)((3 - sum % 3) % 3);
+    return s;
+}
+
+// Classes of corner permutations under the N_SYM_UD symmetries, numbered in order of their smallest
+// member (the representative); each entry is class << 4 | a symmetry taking it to the representative
+void buildCpermSym(std::vector<uint8_t>& storage) {
+    storage.assign((size_t)N_CPERM * sizeof(uint16_t), 0);
+    uint16_t* table = reinterpret_cast<uint16_t*>(storage.data());
+    std::vector<int> classOf(N_CPERM, -1), reps;
+    for (int c = 0; c < N_CPERM; c++) {
+        if (classOf[c] >= 0) continue;
+        CubeState s = cpermState(c);
+        for (int k = 0; k < N_SYM_UD; k++) classOf[cpermCoord(conjugate(s, k))] = (int)reps.size();
+        reps.push_back(c);
+    }
+    for (int c = 0; c < N_CPERM; c++) {
+        CubeState s = cpermState(c);
+        for (int k = 0; k < N_SYM_UD; k++)
+            if (cpermCoord(conjugate(s, k)) == reps[classOf[c]]) { table[c] = (uint16_t)(classOf[c] << 4 | k); break; }
+    }
+}
+
+void buildTwistConj(std::vector<uint8_t>& storage) {
+    storage.assign((size_t)N_TWIST * N_SYM_UD * sizeof(uint16_t), 0);
+    uint16_t* table = reinterpret_cast<uint16_t*>(storage.data());
+    for (int tw = 0; tw < N_TWIST; tw++) {
+        CubeState s = twistState(tw);
+        for (int k = 0; k < N_SYM_UD; k++) table[tw * N_SYM_UD + k] = (uint16_t)twistCoord(conjugate(s, k));
+    }
+}
+
+// Fills table[c * 18 + m] by walking the coordinate space from the solved cube, keeping one
+// representative state per coordinate value. Moves outside the list are left as 0xFFFF.
+template <class Coord>
+void buildMoveTable(std::vector<uint8_t>& storage, int size, Coord coord, const int* moves, int nMoves) {
+    storage.assign((size_t)size * N_FACEMOVES * sizeof(uint16_t), 0xFF);
+    uint16_t* table = reinterpret_cast<uint16_t*>(storage.data());
+    std::vector<CubeState> reps(size); std::vector<char> seen(size, 0);
+    std::vector<int> queue; queue.reserve(size);
+    CubeState solved; int c0 = coord(solved); reps[c0] = solved; seen[c0] = 1; queue.push_back(c0);
+    for (size_t q = 0; q < queue.size(); q++) {
+        int c = queue[q];
+        for (int k = 0; k < nMoves; k++) {
+            CubeState n = reps[c]; applyFaceMove(n, moves[k]);
+            int d = coord(n); table[(size_t)c * N_FACEMOVES + moves[k]] = (uint16_t)d;
+            if (!seen[d]) { seen[d] = 1; reps[d] = n; queue.push_back(d); }
+        }
+    }
+}
+
+// Nibble access that tolerates other threads writing the neighbouring entry of the same byte
+int loadPrune(const uint8_t* table, size_t i) { return (__atomic_load_n(table + (i >> 1), __ATOMIC_RELAXED) >> ((i & 1) << 2)) & 0xF; }
+
+// Sets an unknown (0xF) entry to v; false if it was already known or another thread got there first
+bool claimPrune(uint8_t* table, size_t i, int v) {
+    uint8_t* p = table + (i >> 1);
+    int shift = (i & 1) << 2;
+    uint8_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+    for (;;) {
+        if (((old >> shift) & 0xF) != 0xF) return false;
+        uint8_t next = (uint8_t)((old & ~(0xF << shift)) | (v << shift));
+        if (__atomic_compare_exchange_n(p, &old, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return true;
+    }
+}
+
+// Index = c2 * n1 + c1 over two coordinates and their move tables
+struct PairIndex {
+    int n1; const uint16_t *mv1, *mv2;
+    size_t next(size_t i, int m) const {
+        size_t c1 = i % n1, c2 = i / n1;
+        return (size_t)mv2[c2 * N_FACEMOVES + m] * n1 + mv1[c1 * N_FACEMOVES + m];
+    }
+    size_t claim(uint8_t* table, size_t i, int v) const { return claimPrune(table, i, v); }
+};
+
+// SolverTables::cornerIndex(). A representative fixed by some symmetries has several twists per
+// class that are the same corner state up to symmetry; claiming one claims them all, so none is left
+// for a later level to reach (only the first symmetry found is ever used to index).
+struct CornerClassIndex {
+    const SolverTables& t;
+    std::vector<int> reps;
+    std::vector<std::vector<uint8_t>> stabilizers;
+    explicit CornerClassIndex(const SolverTables& tables) : t(tables), stabilizers(N_CPERM_CLASS) {
+        for (int c = 0; c < N_CPERM; c++) if (t.cpermSym[c] == (t.cpermSym[c] & ~15)) reps.push_back(c);
+        for (int r = 0; r < N_CPERM_CLASS; r++) {
+            CubeState s = cpermState(reps[r]);
+            for (int k = 1; k < N_SYM_UD; k++) if (cpermCoord(conjugate(s, k)) == reps[r]) stabilizers[r].push_back((uint8_t)k);
+        }
+    }
+    size_t next(size_t i, int m) const {
+        int c = reps[i / N_TWIST], tw = (int)(i % N_TWIST);
+        return t.cornerIndex(t.cpermMove[c * N_FACEMOVES + m], t.twistMove[tw * N_FACEMOVES + m]);
+    }
+    size_t claim(uint8_t* table, size_t i, int v) const {
+        size_t cls = i / N_TWIST, tw = i % N_TWIST, n = claimPrune(table, i, v);
+        for (uint8_t k : stabilizers[cls]) n += claimPrune(table, cls * N_TWIST + t.twistConj[tw * N_SYM_UD + k], v);
+        return n;
+    }
+};
+
+// Breadth-first distance table over size entries with the solved state at index 0.
+// Levels are filled forward until most entries are known, then backward from the unknown ones.
+// Each level is split across the shared pool; a level only reads entries set by earlier levels,
+// so the result does not depend on the thread count.
+template <class Index>
+void buildPrune(std::vector<uint8_t>& storage, const char* name, bool verbose, size_t size, const Index& index, const int* moves, int nMoves) {
+    typedef std::chrono::steady_clock Clock;
+    std::atomic<size_t> done(1);
+    storage.assign((size + 1) / 2, 0xFF);
+    uint8_t* table = storage.data();
+    index.claim(table, 0, 0);
+    ThreadPool& pool = sharedThreadPool();
+    Clock::time_point start = Clock::now();
+    for (int depth = 0; done < size && depth < 14; depth++) {
+        bool backward = done > size / 2;
+        Clock::time_point levelStart = Clock::now();
+        pool.parallelFor(size, 1 << 14, [&](size_t begin, size_t end, int) {
+            size_t found = 0;
+            for (size_t i = begin; i < end; i++) {
+                int v = loadPrune(table, i);
+                if (backward ? v != 0xF : v != depth) continue;
+                for (int k = 0; k < nMoves; k++) {
+                    size_t j = index.next(i, moves[k]);
+                    if (backward) { if (loadPrune(table, j) == depth) { found += index.claim(table, i, depth + 1); break; } }
+                    else if (loadPrune(table, j) == 0xF) found += index.claim(table, j, depth + 1);
+                }
+            }
+            done.fetch_add(found, std::memory_order_relaxed);
+        });
+        if (verbose) {
+            long ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - levelStart).count();
+            std::cerr << "Solver tables: " << name << " depth " << depth + 1 << (backward ? " (backward)" : "") << ": "
+                      << done * 100 / size << "% of " << size << " in " << ms << " ms" << std::endl;
+        }
+    }
+    if (verbose) {
+        long ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+        std::cerr << "Solver tables: " << name << " done in " << ms << " ms on " << pool.size() << " threads" << std::endl;
+    }
+}
+
+// Changes whenever the move definitions in cube_state.cpp do, which would invalidate every table
+uint64_t tableFingerprint() {
+    std::vector<uint8_t> bytes;
+    for (int m = 0; m < MOVE_NONE; m++) {
+        CubeState s; s.apply(static_cast<MoveType>(m));
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&s);
+        bytes.insert(bytes.end(), p, p + sizeof(s));
+    }
+    return TableCache::checksum(bytes.data(), bytes.size());
+}
+
+} // namespace
+
+void applyFaceMove(CubeState& s, int m) {
+    MoveType q = faceMoveType[m / 3];
+    switch (m % 3) {
+        case 0: s.apply(q); break;
+        case 1: s.apply(static_cast<MoveType>(MOVE_F2 + q / 2)); break;
+        default: s.apply(static_cast<MoveType>(q + 1)); break;
+    }
+}
+
+void appendFaceMove(int m, std::vector<MoveType>& out) {
+    MoveType q = faceMoveType[m / 3];
+    switch (m % 3) {
+        case 0: out.push_back(q); break;
+        case 1: out.push_back(static_cast<MoveType>(MOVE_F2 + q / 2)); break;
+        default: out.push_back(static_cast<MoveType>(q + 1)); break;
+    }
+}
+
+size_t SolverTables::tableSize(int id) {
+    static const size_t moveRows[SPERM_MOVE + 1] = { N_TWIST, N_FLIP, N_SLICE, N_CPERM, N_UDPERM, N_SPERM };
+    static const size_t pruneEntries[SOLVER_TABLE_COUNT - TWIST_SLICE_PRUNE] = {
+        (size_t)N_TWIST * N_SLICE, (size_t)N_FLIP * N_SLICE, (size_t)N_CPERM * N_SPERM, (size_t)N_UDPERM * N_SPERM, (size_t)N_CPERM_CLASS * N_TWIST };
+    if (id <= SPERM_MOVE) return moveRows[id] * N_FACEMOVES * sizeof(uint16_t);
+    if (id == CPERM_SYM) return (size_t)N_CPERM * sizeof(uint16_t);
+    if (id == TWIST_CONJ) return (size_t)N_TWIST * N_SYM_UD * sizeof(uint16_t);
+    return (pruneEntries[id - TWIST_SLICE_PRUNE] + 1) / 2;
+}
+
+SolverTables::SolverTables(const std::string& cachePath) : path(cachePath), cornerVerified(false) {
+    std::fill(data, data + SOLVER_TABLE_COUNT, nullptr);
+    if (!path.empty() && load()) return;
+    if (!path.empty()) std::cerr << "Solver tables: building " << path << std::endl;
+    // The move and symmetry tables are independent of each other, so build them side by side
+    sharedThreadPool().parallelFor(TWIST_SLICE_PRUNE, 1, [this](size_t begin, size_t end, int) {
+        for (size_t id = begin; id < end; id++) fill((int)id);
+    });
+    for (int id = TWIST_MOVE; id < TWIST_SLICE_PRUNE; id++) data[id] = storage[id].data();
+    bind();
+    for (int id = TWIST_SLICE_PRUNE; id < CORNER_PRUNE; id++) build(id);
+    if (!path.empty()) save();
+}
+
+bool SolverTables::load() {
+    if (!cache.open(path, SOLVER_TABLE_VERSION, tableFingerprint(), SOLVER_TABLE_COUNT)) return false;
+    for (int id = 0; id < SOLVER_TABLE_COUNT; id++) {
+        size_t size; const uint8_t* p = cache.section(id, size);
+        // The optimal-search table is optional and verified when first needed, to keep its pages unloaded
+        bool ok = (id == CORNER_PRUNE) ? (size == 0 || size == tableSize(id)) : (size == tableSize(id) && cache.verify(id));
+        if (!ok) { cache.close(); std::fill(data, data + SOLVER_TABLE_COUNT, nullptr); return false; }
+        data[id] = p;
+    }
+    bind();
+    return true;
+}
+
+void SolverTables::fill(int id) {
+    static const char* const names[SOLVER_TABLE_COUNT] = {
+        "twist moves", "flip moves", "slice moves", "cperm moves", "udperm moves", "sperm moves", "cperm symmetries", "twist conjugates",
+        "twist x slice", "flip x slice", "cperm x sperm", "udperm x sperm", "cperm class x twist" };
+    bool verbose = !path.empty();
+    switch (id) {
+        case TWIST_MOVE: buildMoveTable(storage[id], N_TWIST, twistCoord, allMoves, N_FACEMOVES); break;
+        case FLIP_MOVE: buildMoveTable(storage[id], N_FLIP, flipCoord, allMoves, N_FACEMOVES); break;
+        case SLICE_MOVE: buildMoveTable(storage[id], N_SLICE, sliceCoord, allMoves, N_FACEMOVES); break;
+        case CPERM_MOVE: buildMoveTable(storage[id], N_CPERM, cpermCoord, allMoves, N_FACEMOVES); break;
+        case UDPERM_MOVE: buildMoveTable(storage[id], N_UDPERM, udpermCoord, phase2Moves, 10); break;
+        case SPERM_MOVE: buildMoveTable(storage[id], N_SPERM, spermCoord, phase2Moves, 10); break;
+        case CPERM_SYM: buildCpermSym(storage[id]); break;
+        case TWIST_CONJ: buildTwistConj(storage[id]); break;
+        case TWIST_SLICE_PRUNE: buildPrune(storage[id], names[id], verbose, (size_t)N_TWIST * N_SLICE, PairIndex{ N_TWIST, twistMove, sliceMove }, allMoves, N_FACEMOVES); break;
+        case FLIP_SLICE_PRUNE: buildPrune(storage[id], names[id], verbose, (size_t)N_FLIP * N_SLICE, PairIndex{ N_FLIP, flipMove, sliceMove }, allMoves, N_FACEMOVES); break;
+        case CPERM_SPERM_PRUNE: buildPrune(storage[id], names[id], verbose, (size_t)N_CPERM * N_SPERM, PairIndex{ N_CPERM, cpermMove, spermMove }, phase2Moves, 10); break;
+        case UDPERM_SPERM_PRUNE: buildPrune(storage[id], names[id], verbose, (size_t)N_UDPERM * N_SPERM, PairIndex{ N_UDPERM, udpermMove, spermMove }, phase2Moves, 10); break;
+        case CORNER_PRUNE: buildPrune(storage[id], names[id], verbose, (size_t)N_CPERM_CLASS * N_TWIST, CornerClassIndex(*this), allMoves, N_FACEMOVES); break;
+    }
+}
+
+void SolverTables::build(int id) {
+    fill(id);
+    data[id] = storage[id].data();
+    bind();
+}
+
+void SolverTables::bind() {
+    twistMove = reinterpret_cast<const uint16_t*>(data[TWIST_MOVE]); flipMove = reinterpret_cast<const uint16_t*>(data[FLIP_MOVE]);
+    sliceMove = reinterpret_cast<const uint16_t*>(data[SLICE_MOVE]); cpermMove = reinterpret_cast<const uint16_t*>(data[CPERM_MOVE]);
+    udpermMove = reinterpret_cast<const uint16_t*>(data[UDPERM_MOVE]); spermMove = reinterpret_cast<const uint16_t*>(data[SPERM_MOVE]);
+    cpermSym = reinterpret_cast<const uint16_t*>(data[CPERM_SYM]); twistConj = reinterpret_cast<const uint16_t*>(data[TWIST_CONJ]);
+    twistSlicePrune = data[TWIST_SLICE_PRUNE]; flipSlicePrune = data[FLIP_SLICE_PRUNE];
+    cpermSpermPrune = data[CPERM_SPERM_PRUNE]; udpermSpermPrune = data[UDPERM_SPERM_PRUNE];
+    cornerPrune = data[CORNER_PRUNE];
+}
+
+void SolverTables::save() {
+    std::vector<TableSection> sections;
+    for (int id = 0; id < SOLVER_TABLE_COUNT; id++) sections.push_back({ data[id], data[id] ? tableSize(id) : 0 });
+    if (!TableCache::write(path, SOLVER_TABLE_VERSION, tableFingerprint(), sections))
+        std::cerr << "Solver tables: could not write " << path << std::endl;
+}
+
+void SolverTables::ensureCornerPrune() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cornerPrune && (cornerVerified || !storage[CORNER_PRUNE].empty())) return;
+    if (cornerPrune && cache.isOpen() && cache.verify(CORNER_PRUNE)) { cornerVerified = true; return; }
+    if (!path.empty()) std::cerr << "Solver tables: building optimal-search table" << std::endl;
+    build(CORNER_PRUNE);
+    if (!path.empty()) save();
+}
+
+SolverTables& solverTables() {
+    static SolverTables tables(SOLVER_TABLE_FILE);
+    return tables;
+}
+
+// Once the deadline passes or the solve is cancelled every later call says so too, so the whole
+// search unwinds
+bool Solver::expired() {
+    if ((timed || cancel) && !timedOut && (++nodes & 0xFFF) == 0)
+        timedOut = (timed && Clock::now() > deadline) || (cancel && cancel->load(std::memory_order_relaxed));
+    return timedOut;
+}
+
+bool Solver::phase2(int cperm, int udperm, int sperm, int depth, int togo, int lastFace) {
+    if (togo == 0) return cperm == 0 && udperm == 0 && sperm == 0;
+    for (int k = 0; k < 10; k++) {
+        int m = phase2Moves[k];
+        if (redundant(m / 3, lastFace)) continue;
+        int c = t.cpermMove[cperm * N_FACEMOVES + m], u = t.udpermMove[udperm * N_FACEMOVES + m], s = t.spermMove[sperm * N_FACEMOVES + m];
+        int h = std::max(SolverTables::prune(t.cpermSpermPrune, (size_t)s * N_CPERM + c), SolverTables::prune(t.udpermSpermPrune, (size_t)s * N_UDPERM + u));
+        if (h >= togo) continue;
+        path[depth] = m;
+        if (phase2(c, u, s, depth + 1, togo - 1, m / 3)) return true;
+        if (expired()) return false;
+    }
+    return false;
+}
+
+bool Solver::startPhase2(int depth1) {
+    CubeState s = start;
+    for (int i = 0; i < depth1; i++) applyFaceMove(s, path[i]);
+    int cperm = cpermCoord(s), udperm = udpermCoord(s), sperm = spermCoord(s);
+    int h = std::max(SolverTables::prune(t.cpermSpermPrune, (size_t)sperm * N_CPERM + cperm), SolverTables::prune(t.udpermSpermPrune, (size_t)sperm * N_UDPERM + udperm));
+    int lastFace = depth1 > 0 ? path[depth1 - 1] / 3 : -1;
+    for (int len = h; depth1 + len < bestLength; len++) {
+        if (!phase2(cperm, udperm, sperm, depth1, len, lastFace)) continue;
+        bestLength = depth1 + len; best.assign(path, path + bestLength);
+        return true;
+    }
+    return false;
+}
+
+bool Solver::phase1(int twist, int flip, int slice, int depth, int togo) {
+    if (togo == 0) {
+        if (twist || flip || slice) return false;
+        // A phase-1 path ending in a phase-2 turn was already tried one level shallower
+        if (depth > 0 && isPhase2Move(path[depth - 1])) return false;
+        return startPhase2(depth);
+    }
+    int lastFace = depth > 0 ? path[depth - 1] / 3 : -1;
+    for (int m = 0; m < N_FACEMOVES; m++) {
+        if (redundant(m / 3, lastFace)) continue;
+        int tw = t.twistMove[twist * N_FACEMOVES + m], fl = t.flipMove[flip * N_FACEMOVES + m], sl = t.sliceMove[slice * N_FACEMOVES + m];
+        int h = std::max(SolverTables::prune(t.twistSlicePrune, (size_t)sl * N_TWIST + tw), SolverTables::prune(t.flipSlicePrune, (size_t)sl * N_FLIP + fl));
+        if (h >= togo) continue;
+        path[depth] = m;
+        if (phase1(tw, fl, sl, depth + 1, togo - 1)) return true;
+        if (expired()) return false;
+    }
+    return false;
+}
+
+bool Solver::search(int maxLength) {
+    int twist = twistCoord(start), flip = flipCoord(start), slice = sliceCoord(start);
+    for (int depth1 = 0; depth1 < bestLength && depth1 <= maxLength; depth1++)
+        if (phase1(twist, flip, slice, 0, depth1)) return true;
+    return false;
+}
+
+// Iterative deepening from 0 means no node has a solution shorter than togo. So a node that fails
+// proves its state needs more than togo turns unless the first one is on the last turn's axis, which
+// holds for every symmetric state too (with the axis mapped): the transposition table keeps that
+// depth per class and axis. After D, L or B the search tries nothing else and may stop at once; after
+// U, R or F it still has D, L or B to try.
+bool Solver::optimal(const CubeState& s, int twist, int flip, int slice, int cperm, int depth, int togo) {
+    if (togo == 0) return s.isSolved();
+    int lastFace = depth > 0 ? path[depth - 1] / 3 : -1;
+    uint64_t key = 0; bool oppositeOnly = false;
+    if (lastFace >= 0 && togo >= TRANSPOSITION_DEPTH) {
+        key = TranspositionTable::key(s, lastFace % 3);
+        if (transpositions->probe(key) >= togo) { if (lastFace >= 3) return false; oppositeOnly = true; }
+    }
+    for (int m = 0; m < N_FACEMOVES; m++) {
+        if (redundant(m / 3, lastFace) || (oppositeOnly && m / 3 != lastFace + 3)) continue;
+        int tw = t.twistMove[twist * N_FACEMOVES + m], fl = t.flipMove[flip * N_FACEMOVES + m], sl = t.sliceMove[slice * N_FACEMOVES + m], c = t.cpermMove[cperm * N_FACEMOVES + m];
+        int h = std::max(SolverTables::prune(t.cornerPrune, t.cornerIndex(c, tw)),
+                std::max(SolverTables::prune(t.twistSlicePrune, (size_t)sl * N_TWIST + tw), SolverTables::prune(t.flipSlicePrune, (size_t)sl * N_FLIP + fl)));
+        if (h >= togo) continue;
+        CubeState n = s; applyFaceMove(n, m);
+        path[depth] = m;
+        if (optimal(n, tw, fl, sl, c, depth + 1, togo - 1)) return true;
+        if (expired()) return false;
+    }
+    if (key) transpositions->store(key, togo); // not reached on a timeout, which proves nothing
+    return false;
+}
+
+bool Solver::solve(const CubeState& state, std::vector<MoveType>& out, int maxLength, double timeBudget, const SolveProgress& progress) {
+    out.clear(); best.clear();
+    int twistSum = 0, flipSum = 0;
+    for (int i = 0; i < 8; i++) twistSum += state.co[i];
+    for (int i = 0; i < 12; i++) flipSum += state.eo[i];
+    if (twistSum % 3 || flipSum % 2) return false;
+
+    // Slice turns move the centers; bring them home first so the rest is a face-turn problem.
+    // The centers only ever take the 24 rotations of the solved arrangement, so fixed arrays do.
+    static const MoveType sliceMoves[6] = { MOVE_M, MOVE_M_PRIME, MOVE_E, MOVE_E_PRIME, MOVE_S, MOVE_S_PRIME };
+    const CubeState solved;
+    CubeState frontier[24]; int parent[24]; MoveType via[24];
+    int count = 1, found = -1;
+    frontier[0] = state; parent[0] = -1;
+    for (int i = 0; i < count && found < 0; i++) {
+        if (std::equal(solved.centers, solved.centers + 6, frontier[i].centers)) { found = i; break; }
+        for (MoveType m : sliceMoves) {
+            CubeState n = frontier[i]; n.apply(m);
+            bool seen = false;
+            for (int k = 0; k < count && !seen; k++) seen = std::equal(frontier[k].centers, frontier[k].centers + 6, n.centers);
+            if (!seen && count < 24) { frontier[count] = n; parent[count] = i; via[count] = m; count++; }
+        }
+    }
+    if (found < 0) return false;
+    start = frontier[found];
+    for (int i = found; parent[i] >= 0; i = parent[i]) out.push_back(via[i]);
+    std::reverse(out.begin(), out.end());
+    // Corner and edge permutation parities must agree once the centers are home
+    int parity = 0;
+    for (int i = 0; i < 8; i++) for (int j = i + 1; j < 8; j++) parity ^= start.cp[j] < start.cp[i];
+    for (int i = 0; i < 12; i++) for (int j = i + 1; j < 12; j++) parity ^= start.ep[j] < start.ep[i];
+    if (parity) { out.clear(); return false; }
+
+    timed = timedOut = false; nodes = 0; bestLength = maxLength + 1;
+    if (!search(maxLength)) { out.clear(); return false; }
+    const size_t centerMoves = out.size();
+    auto report = [&] {
+        if (!progress) return;
+        out.resize(centerMoves);
+        for (int m : best) appendFaceMove(m, out);
+        progress(out);
+    };
+    report();
+
+    if (timeBudget > 0 && bestLength > 0) {
+        // Building the optimal-search table on a cold cache is not part of the budget: it starts after
+        if (!(cancel && cancel->load(std::memory_order_relaxed))) {
+            t.ensureCornerPrune();
+            if (!transpositions) transpositions = &sharedTranspositionTable();
+        }
+        Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeBudget));
+        if (progress) {
+            timed = true; deadline = Clock::now() + (end - Clock::now()) / 2;
+            while (bestLength > 0 && search(bestLength - 1)) report();
+        }
+        bool cancelled = cancel && cancel->load(std::memory_order_relaxed);
+        timed = true; timedOut = cancelled; nodes = 0; deadline = end;
+        int twist = twistCoord(start), flip = flipCoord(start), slice = sliceCoord(start), cperm = cpermCoord(start);
+        for (int depth = 0; depth < bestLength && !timedOut && Clock::now() < deadline; depth++) {
+            if (!optimal(start, twist, flip, slice, cperm, 0, depth)) continue;
+            bestLength = depth; best.assign(path, path + depth);
+            report();
+            break;
+        }
+    }
+    out.resize(centerMoves);
+    for (int m : best) appendFaceMove(m, out);
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+// Two-phase (Kociemba) solver on top of CubeState, plus an optional IDA* optimal search.
+#include "cube_state.h"
+#include "cube_symmetry.h"
+#include "table_cache.h"
+#include "transposition_table.h"
+
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Coordinate sizes: corner twist, edge flip, UD-slice edge positions (phase 1);
+// corner permutation, U/D edge permutation, slice edge permutation (phase 2)
+const int N_TWIST = 2187, N_FLIP = 2048, N_SLICE = 495;
+const int N_CPERM = 40320, N_UDPERM = 40320, N_SPERM = 24;
+const int N_FACEMOVES = 18; // U R F D L B, each as quarter / half / inverse turn
+const int N_CPERM_CLASS = 2768; // corner permutations up to the N_SYM_UD symmetries
+
+enum SolverTableId {
+    TWIST_MOVE, FLIP_MOVE, SLICE_MOVE, CPERM_MOVE, UDPERM_MOVE, SPERM_MOVE, CPERM_SYM, TWIST_CONJ,
+    TWIST_SLICE_PRUNE, FLIP_SLICE_PRUNE, CPERM_SPERM_PRUNE, UDPERM_SPERM_PRUNE, CORNER_PRUNE, SOLVER_TABLE_COUNT
+};
+const uint32_t SOLVER_TABLE_VERSION = 2; // bump when a table's layout or contents change
+const char* const SOLVER_TABLE_FILE = "rubik_tables.bin";
+
+// Move tables are [coordinate * N_FACEMOVES + move]; pruning tables pack one distance per nibble.
+// The pointers refer either to tables built in memory or to a read-only mapping of the cache file.
+struct SolverTables {
+    const uint16_t *twistMove, *flipMove, *sliceMove, *cpermMove, *udpermMove, *spermMove;
+    // cpermSym[cperm] = class << 4 | the symmetry taking it to its class representative;
+    // twistConj[twist * N_SYM_UD + sym] = that twist conjugated by sym
+    const uint16_t *cpermSym, *twistConj;
+    const uint8_t *twistSlicePrune, *flipSlicePrune, *cpermSpermPrune, *udpermSpermPrune;
+    // Corner distances per symmetry class, [cornerIndex()]: ~3 MB rather than 44 for cperm x twist.
+    // Null until ensureCornerPrune().
+    const uint8_t *cornerPrune;
+
+    // With a cache path the tables are mapped from it, and built and written there if it is missing or stale
+    explicit SolverTables(const std::string& cachePath = std::string());
+    // Builds (or verifies the cached copy of) the optimal-search table; safe to call from several threads
+    void ensureCornerPrune();
+    static int prune(const uint8_t* table, size_t index) { return (table[index >> 1] >> ((index & 1) << 2)) & 0xF; }
+    // The corners conjugated onto their class representative: its class, then the twist there
+    size_t cornerIndex(int cperm, int twist) const {
+        int s = cpermSym[cperm];
+        return (size_t)(s >> 4) * N_TWIST + twistConj[twist * N_SYM_UD + (s & 15)];
+    }
+    static size_t tableSize(int id);
+
+private:
+    std::string path;
+    TableCache cache;
+    std::mutex mutex;
+    bool cornerVerified;
+    std::vector<uint8_t> storage[SOLVER_TABLE_COUNT];
+    const uint8_t* data[SOLVER_TABLE_COUNT];
+
+    bool load();
+    void fill(int id);  // builds storage[id] only
+    void build(int id); // fill, then publish through the pointers
+    void bind();
+    void save();
+};
+
+// Shared tables backed by SOLVER_TABLE_FILE, created on first use
+SolverTables& solverTables();
+
+// Called with each solution a solve finds, in the same form as its result, every one shorter than the last
+typedef std::function<void(const std::vector<MoveType>&)> SolveProgress;
+
+class Solver {
+public:
+    // Optimal searches share transpositions, sharedTranspositionTable() when none is given
+    explicit Solver(SolverTables& tables = solverTables(), TranspositionTable* transpositionTable = nullptr)
+        : t(tables), transpositions(transpositionTable), cancel(nullptr) {}
+
+    // Writes a solution for state to out: M/E/S turns to re-seat displaced centers, then face turns
+    // (quarter or half turns, as MoveType). The two-phase search stops at the first solution of at
+    // most maxLength face turns. With timeBudget > 0 (seconds) an IDA* optimal search runs afterwards and
+    // replaces it if it finishes in time; the time counts from once the optimal-search table is ready
+    // (ensureCornerPrune(), which may have to build it first). Returns false if no solution was found.
+    // With progress, every solution found is also reported as it comes, and the two-phase search
+    // keeps looking for shorter ones for the first half of timeBudget before the optimal search.
+    bool solve(const CubeState& state, std::vector<MoveType>& out, int maxLength = 22, double timeBudget = 0.0,
+               const SolveProgress& progress = SolveProgress());
+    // Once *flag is set (from any thread) a running solve() stops within a few thousand nodes and
+    // returns what it has found so far; nullptr to stop checking
+    void setCancel(const std::atomic<bool>* flag) { cancel = flag; }
+
+    // Face-turn solution of the last successful solve() in internal encoding (face * 3 + power)
+    const std::vector<int>& faceMoves() const { return best; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    SolverTables& t;
+    TranspositionTable* transpositions;
+    CubeState start;
+    int path[32], bestLength;
+    std::vector<int> best;
+    Clock::time_point deadline; bool timed, timedOut; long nodes;
+    const std::atomic<bool>* cancel;
+
+    bool search(int maxLength);
+    bool phase1(int twist, int flip, int slice, int depth, int togo);
+    bool phase2(int cperm, int udperm, int sperm, int depth, int togo, int lastFace);
+    bool startPhase2(int depth1);
+    bool optimal(const CubeState& s, int twist, int flip, int slice, int cperm, int depth, int togo);
+    bool expired();
+};
+
+// Internal face-turn encoding (face * 3 + power) applied to a state, or converted to a MoveType
+void appendFaceMove(int m, std::vector<MoveType>& out);
+void applyFaceMove(CubeState& s, int m);
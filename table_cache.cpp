@@ -0,0 +1,104 @@
+#include "table_cache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = { 'R', 'B', 'K', 'T', 'A', 'B', 'L', 'E' };
+const uint32_t BYTE_ORDER_TAG = 0x01020304;
+const uint64_t ALIGNMENT = 4096;
+
+// File layout: Header, Header::sectionCount entries, then each section at a page-aligned offset
+struct Header {
+    char magic[8];
+    uint32_t byteOrder, version;
+    uint64_t fingerprint;
+    uint32_t sectionCount, reserved;
+    uint64_t headerChecksum; // over the section entries
+};
+
+uint64_t alignUp(uint64_t v) { return (v + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+} // namespace
+
+uint64_t TableCache::checksum(const void* data, size_t size) {
+    // FNV-1a over 64-bit words, then the tail bytes
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = 0xcbf29ce484222325ull;
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; i++) { uint64_t w; std::memcpy(&w, p + i * 8, 8); h = (h ^ w) * 0x100000001b3ull; }
+    for (size_t i = words * 8; i < size; i++) h = (h ^ p[i]) * 0x100000001b3ull;
+    return h ^ size;
+}
+
+bool TableCache::open(const std::string& path, uint32_t version, uint64_t fingerprint, int sectionCount) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) { ::close(fd); return false; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    base = static_cast<uint8_t*>(p); length = (size_t)st.st_size;
+
+    Header h; std::memcpy(&h, base, sizeof(h));
+    size_t entryBytes = (size_t)sectionCount * sizeof(Entry);
+    bool ok = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.byteOrder == BYTE_ORDER_TAG && h.version == version &&
+              h.fingerprint == fingerprint && h.sectionCount == (uint32_t)sectionCount && sizeof(Header) + entryBytes <= length &&
+              h.headerChecksum == checksum(base + sizeof(Header), entryBytes);
+    if (ok) {
+        entries.resize(sectionCount);
+        std::memcpy(entries.data(), base + sizeof(Header), entryBytes);
+        for (const Entry& e : entries) if (e.offset + e.size > length) ok = false;
+    }
+    if (!ok) close();
+    return ok;
+}
+
+void TableCache::close() {
+    if (base) munmap(base, length);
+    base = nullptr; length = 0; entries.clear();
+}
+
+const uint8_t* TableCache::section(int index, size_t& size) const {
+    size = entries[index].size;
+    return size ? base + entries[index].offset : nullptr;
+}
+
+bool TableCache::verify(int index) const {
+    const Entry& e = entries[index];
+    return checksum(base + e.offset, e.size) == e.checksum;
+}
+
+bool TableCache::write(const std::string& path, uint32_t version, uint64_t fingerprint, const std::vector<TableSection>& sections) {
+    std::vector<Entry> table(sections.size());
+    uint64_t offset = alignUp(sizeof(Header) + sections.size() * sizeof(Entry));
+    for (size_t i = 0; i < sections.size(); i++) {
+        table[i] = { sections[i].size ? offset : 0, sections[i].size, checksum(sections[i].data, sections[i].size) };
+        offset = alignUp(offset + sections[i].size);
+    }
+    Header h; std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.byteOrder = BYTE_ORDER_TAG; h.version = version; h.fingerprint = fingerprint; h.sectionCount = (uint32_t)sections.size();
+    h.headerChecksum = checksum(table.data(), table.size() * sizeof(Entry));
+
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 && std::fwrite(table.data(), sizeof(Entry), table.size(), f) == table.size();
+    for (size_t i = 0; ok && i < sections.size(); i++) {
+        if (!sections[i].size) continue;
+        ok = std::fseek(f, (long)table[i].offset, SEEK_SET) == 0 && std::fwrite(sections[i].data, 1, sections[i].size, f) == sections[i].size;
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    if (ok) ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) std::remove(tmp.c_str());
+    return ok;
+}
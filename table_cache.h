@@ -0,0 +1,36 @@
+#pragma once
+// Versioned on-disk cache of precomputed tables, mapped read-only so pages load on first touch.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TableSection { const void* data; size_t size; };
+
+class TableCache {
+public:
+    TableCache() : base(nullptr), length(0) {}
+    ~TableCache() { close(); }
+    TableCache(const TableCache&) = delete;
+    TableCache& operator=(const TableCache&) = delete;
+
+    // Maps path and checks magic, version, fingerprint, header checksum and section count.
+    // Returns false (leaving nothing mapped) if the file is missing or stale.
+    bool open(const std::string& path, uint32_t version, uint64_t fingerprint, int sectionCount);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    // Section data, or nullptr if the file stores it empty
+    const uint8_t* section(int index, size_t& size) const;
+    // Hashes the section's pages and compares with the stored checksum
+    bool verify(int index) const;
+
+    // Writes all sections to path (through a temp file and rename, so readers never see a partial file)
+    static bool write(const std::string& path, uint32_t version, uint64_t fingerprint, const std::vector<TableSection>& sections);
+    static uint64_t checksum(const void* data, size_t size);
+
+private:
+    struct Entry { uint64_t offset, size, checksum; };
+    uint8_t* base; size_t length;
+    std::vector<Entry> entries;
+};
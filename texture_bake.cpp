@@ -0,0 +1,156 @@
+// Offline texture baker: PNG to DDS with every mip level, block compressed so the game uploads
+// the file as mapped. bc1-srgb for opaque sRGB images (the skybox), bc3 for linear RGBA (the logo).
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "dds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Image { int width, height; std::vector<uint8_t> rgba; };
+
+int usage() {
+    std::cerr << "Usage: rubik_texbake <bc1-srgb|bc3> <out.dds> <in.png> [5 more faces]\n"
+                 "  One input makes a 2D texture; six (+X -X +Y -Y +Z -Z) make a cubemap.\n";
+    return 1;
+}
+
+float toLinear(uint8_t c) { float v = c / 255.0f; return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f); }
+uint8_t toSrgb(float v) { v = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1 / 2.4f) - 0.055f; return (uint8_t)std::min(255.0f, std::max(0.0f, v * 255 + 0.5f)); }
+
+// 2x2 box filter; odd edges reuse the last row or column. sRGB color is averaged in linear light.
+Image downsample(const Image& src, bool srgb) {
+    Image dst; dst.width = std::max(1, src.width / 2); dst.height = std::max(1, src.height / 2);
+    dst.rgba.resize((size_t)dst.width * dst.height * 4);
+    for (int y = 0; y < dst.height; y++) for (int x = 0; x < dst.width; x++) for (int c = 0; c < 4; c++) {
+        float sum = 0;
+        for (int dy = 0; dy < 2; dy++) for (int dx = 0; dx < 2; dx++) {
+            int sx = std::min(2 * x + dx, src.width - 1), sy = std::min(2 * y + dy, src.height - 1);
+            uint8_t v = src.rgba[((size_t)sy * src.width + sx) * 4 + c];
+            sum += (srgb && c < 3) ? toLinear(v) : v;
+        }
+        dst.rgba[((size_t)y * dst.width + x) * 4 + c] = (srgb && c < 3) ? toSrgb(sum / 4) : (uint8_t)(sum / 4 + 0.5f);
+    }
+    return dst;
+}
+
+uint16_t pack565(const float* c) {
+    int r = (int)std::lround(std::min(255.0f, std::max(0.0f, c[0])) * 31 / 255), g = (int)std::lround(std::min(255.0f, std::max(0.0f, c[1])) * 63 / 255);
+    int b = (int)std::lround(std::min(255.0f, std::max(0.0f, c[2])) * 31 / 255);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+void unpack565(uint16_t v, int* c) { c[0] = ((v >> 11) & 31) * 255 / 31; c[1] = ((v >> 5) & 63) * 255 / 63; c[2] = (v & 31) * 255 / 31; }
+
+// BC1 color block: endpoints at the extremes of the pixels along their principal axis, four-color mode
+void encodeColor(const uint8_t px[16][4], uint8_t* out) {
+    float mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) for (int c = 0; c < 3; c++) mean[c] += px[i][c] / 16.0f;
+    float cov[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        float d[3] = { px[i][0] - mean[0], px[i][1] - mean[1], px[i][2] - mean[2] };
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2]; cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = { 1, 1, 1 };
+    for (int it = 0; it < 8; it++) {
+        float n[3] = { cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2], cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                       cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2] };
+        float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len < 1e-6f) break;
+        for (int c = 0; c < 3; c++) axis[c] = n[c] / len;
+    }
+    float lo = 1e9f, hi = -1e9f;
+    for (int i = 0; i < 16; i++) {
+        float t = (px[i][0] - mean[0]) * axis[0] + (px[i][1] - mean[1]) * axis[1] + (px[i][2] - mean[2]) * axis[2];
+        lo = std::min(lo, t); hi = std::max(hi, t);
+    }
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++) { e0[c] = mean[c] + axis[c] * hi; e1[c] = mean[c] + axis[c] * lo; }
+    uint16_t c0 = pack565(e0), c1 = pack565(e1);
+    if (c0 < c1) std::swap(c0, c1);
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        int p[4][3]; unpack565(c0, p[0]); unpack565(c1, p[1]);
+        for (int c = 0; c < 3; c++) { p[2][c] = (2 * p[0][c] + p[1][c]) / 3; p[3][c] = (p[0][c] + 2 * p[1][c]) / 3; }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 1 << 30;
+            for (int k = 0; k < 4; k++) {
+                int e = 0; for (int c = 0; c < 3; c++) e += (px[i][c] - p[k][c]) * (px[i][c] - p[k][c]);
+                if (e < bestError) { bestError = e; best = k; }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+    out[0] = (uint8_t)c0; out[1] = (uint8_t)(c0 >> 8); out[2] = (uint8_t)c1; out[3] = (uint8_t)(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4);
+}
+
+// BC3 alpha block: min and max as endpoints, eight interpolated values
+void encodeAlpha(const uint8_t px[16][4], uint8_t* out) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) { a0 = std::max(a0, (int)px[i][3]); a1 = std::min(a1, (int)px[i][3]); }
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        int p[8] = { a0, a1 };
+        for (int k = 1; k < 7; k++) p[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            for (int k = 1; k < 8; k++) if (std::abs(px[i][3] - p[k]) < std::abs(px[i][3] - p[best])) best = k;
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+    out[0] = (uint8_t)a0; out[1] = (uint8_t)a1;
+    for (int b = 0; b < 6; b++) out[2 + b] = (uint8_t)(indices >> (8 * b));
+}
+
+// Appends one level; partial blocks at the right and bottom edges repeat the last pixel
+void encodeLevel(const Image& img, uint32_t format, std::vector<uint8_t>& out) {
+    bool alpha = DdsFile::blockBytes(format) == 16;
+    for (int by = 0; by < img.height; by += 4) for (int bx = 0; bx < img.width; bx += 4) {
+        uint8_t px[16][4];
+        for (int i = 0; i < 16; i++) {
+            int x = std::min(bx + i % 4, img.width - 1), y = std::min(by + i / 4, img.height - 1);
+            std::memcpy(px[i], &img.rgba[((size_t)y * img.width + x) * 4], 4);
+        }
+        uint8_t block[16];
+        if (alpha) { encodeAlpha(px, block); encodeColor(px, block + 8); }
+        else encodeColor(px, block);
+        out.insert(out.end(), block, block + (alpha ? 16 : 8));
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 4 && argc != 9) return usage();
+    uint32_t format;
+    if (std::strcmp(argv[1], "bc1-srgb") == 0) format = DDS_BC1_SRGB;
+    else if (std::strcmp(argv[1], "bc3") == 0) format = DDS_BC3_UNORM;
+    else return usage();
+    bool srgb = format == DDS_BC1_SRGB || format == DDS_BC3_SRGB;
+
+    int faces = argc - 3, width = 0, height = 0, mips = 0;
+    std::vector<uint8_t> data;
+    for (int f = 0; f < faces; f++) {
+        Image img; int n;
+        unsigned char* px = stbi_load(argv[3 + f], &img.width, &img.height, &n, 4);
+        if (!px) { std::cerr << "rubik_texbake: could not read " << argv[3 + f] << std::endl; return 2; }
+        img.rgba.assign(px, px + (size_t)img.width * img.height * 4);
+        stbi_image_free(px);
+        if (f == 0) { width = img.width; height = img.height; }
+        else if (img.width != width || img.height != height) { std::cerr << "rubik_texbake: cubemap faces differ in size" << std::endl; return 2; }
+        for (mips = 1;; mips++) {
+            encodeLevel(img, format, data);
+            if (img.width == 1 && img.height == 1) break;
+            img = downsample(img, srgb);
+        }
+    }
+    if (!DdsFile::write(argv[2], format, width, height, mips, faces, data)) { std::cerr << "rubik_texbake: could not write " << argv[2] << std::endl; return 2; }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "texture_stream.h"
+#include "stb_image.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+TextureStream::~TextureStream() {
+    for (std::thread& t : decoders) t.join();
+    for (const std::unique_ptr<Image>& img : images) stbi_image_free(img->pixels);
+}
+
+TextureStream::Image* TextureStream::find(const std::string& path) {
+    for (const std::unique_ptr<Image>& img : images) if (img->path == path) return img.get();
+    return nullptr;
+}
+
+void TextureStream::prefetch(const std::vector<std::string>& paths) {
+    std::vector<Image*> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::string& p : paths) {
+            if (find(p)) continue;
+            images.emplace_back(new Image{ p, 0, 0, 0, nullptr, false, false });
+            batch.push_back(images.back().get());
+        }
+    }
+    if (batch.empty()) return;
+    decoders.emplace_back([this, batch]() {
+        sharedThreadPool().parallelFor(batch.size(), 1, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; i++) {
+                int w = 0, h = 0, n = 0;
+                unsigned char* px = stbi_load(batch[i]->path.c_str(), &w, &h, &n, 0);
+                std::lock_guard<std::mutex> lock(mutex);
+                batch[i]->pixels = px; batch[i]->width = w; batch[i]->height = h; batch[i]->channels = n;
+                batch[i]->decoded = true;
+            }
+        });
+    });
+}
+
+void TextureStream::attach(const std::string& path, GLuint texture, GLenum target, bool srgb) {
+    prefetch({ path });
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back({ find(path), texture, target, srgb });
+}
+
+// All images of texture are decoded (a cubemap is only complete with six same-sized faces)
+bool TextureStream::ready(GLuint texture) {
+    for (const Upload& u : pending) if (u.texture == texture && !u.image->decoded) return false;
+    return true;
+}
+
+void TextureStream::upload(const Upload& u) {
+    const Image& img = *u.image;
+    if (!img.pixels) return; // unreadable: the placeholder stays, like the synchronous loaders' fallbacks
+    size_t size = (size_t)img.width * img.height * img.channels;
+    if (!pbo) glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_DRAW); // orphan the previous upload
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst) {
+        std::memcpy(dst, img.pixels, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLenum format = img.channels == 4 ? GL_RGBA : img.channels == 3 ? GL_RGB : img.channels == 2 ? GL_RG : GL_RED;
+        GLenum internal = u.srgb ? (img.channels == 4 ? GL_SRGB8_ALPHA8 : GL_SRGB8) : format;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(u.target, 0, internal, img.width, img.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool TextureStream::poll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Upload& first : pending) {
+        if (!ready(first.texture)) continue;
+        GLuint texture = first.texture;
+        GLenum base = first.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+        glBindTexture(base, texture);
+        bool any = false;
+        for (const Upload& u : pending) if (u.texture == texture) { upload(u); any |= u.image->pixels != nullptr; }
+        if (any) {
+            glTexParameteri(base, GL_TEXTURE_MAX_LEVEL, 1000);
+            glGenerateMipmap(base);
+        }
+        for (const Upload& u : pending) if (u.texture == texture && !u.image->kept) { stbi_image_free(u.image->pixels); u.image->pixels = nullptr; }
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [texture](const Upload& u) { return u.texture == texture; }), pending.end());
+        return any;
+    }
+    return false;
+}
+
+void TextureStream::keep(const std::vector<std::string>& paths) {
+    prefetch(paths);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::string& p : paths) find(p)->kept = true;
+}
+
+void TextureStream::unkeep(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::string& p : paths) {
+        Image* img = find(p);
+        if (!img) continue;
+        img->kept = false;
+        // Still to be uploaded: poll() frees it then
+        if (std::none_of(pending.begin(), pending.end(), [img](const Upload& u) { return u.image == img; })) { stbi_image_free(img->pixels); img->pixels = nullptr; }
+    }
+}
+
+bool TextureStream::pixels(const std::string& path, const unsigned char*& data, int& width, int& height, int& channels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Image* img = find(path);
+    if (!img || !img->decoded) return false;
+    data = img->pixels; width = img->width; height = img->height; channels = img->channels;
+    return true;
+}
+
+void TextureStream::finish() {
+    for (std::thread& t : decoders) t.join();
+    decoders.clear();
+    while (busy()) poll();
+}
+
+void TextureStream::release() {
+    if (pbo) glDeleteBuffers(1, &pbo);
+    pbo = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+// PNG textures decoded off the main thread and uploaded through a pixel buffer object. A texture
+// keeps its 1x1 placeholder until every image it needs has decoded, then poll() swaps the real
+// images in under the same texture name.
+#include <GL/glew.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TextureStream {
+public:
+    TextureStream() : pbo(0) {}
+    ~TextureStream(); // waits for the decoders; GL objects need release() first
+    TextureStream(const TextureStream&) = delete;
+    TextureStream& operator=(const TextureStream&) = delete;
+
+    // Starts decoding paths right away (no GL needed), spread over sharedThreadPool() by a
+    // background thread. Paths already requested are skipped.
+    void prefetch(const std::vector<std::string>& paths);
+
+    // GL, main thread. target is GL_TEXTURE_2D or a cubemap face of texture; srgb picks the
+    // internal format. Prefetches path if that hasn't happened yet.
+    void attach(const std::string& path, GLuint texture, GLenum target, bool srgb);
+
+    // GL, main thread: uploads at most one texture whose images are all decoded, then generates
+    // its mipmaps. Returns true if it changed a texture, so the frame needs redrawing.
+    bool poll();
+    bool busy() const { return !pending.empty(); }
+
+    // Keeps the decoded pixels of paths (prefetching them) past their upload, for a CPU-side user
+    // such as the IBL bake, until unkeep(). Call it before poll() can have uploaded them.
+    void keep(const std::vector<std::string>& paths);
+    void unkeep(const std::vector<std::string>& paths);
+    // Any thread: true once a kept path has decoded, with its pixels as stbi_load left them (nullptr
+    // if it can't be read), valid until unkeep()
+    bool pixels(const std::string& path, const unsigned char*& data, int& width, int& height, int& channels);
+    // Blocks until every attached texture is uploaded
+    void finish();
+    void release();
+
+private:
+    struct Image { std::string path; int width, height, channels; unsigned char* pixels; bool decoded, kept; };
+    struct Upload { Image* image; GLuint texture; GLenum target; bool srgb; };
+
+    std::mutex mutex; // guards Image::decoded/kept/pixels/size between decoders and the GL thread
+    std::vector<std::unique_ptr<Image>> images;
+    std::vector<std::thread> decoders;
+    std::vector<Upload> pending;
+    GLuint pbo;
+
+    Image* find(const std::string& path);
+    bool ready(GLuint texture);
+    void upload(const Upload& u);
+};
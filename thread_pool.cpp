@@ -0,0 +1,82 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+thread_local bool insidePool = false; // set while running a chunk, so nested loops run inline
+}
+
+ThreadPool::ThreadPool(int threads) : job(nullptr), jobCount(0), jobGrain(1), generation(0), active(0), stopping(false) {
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+    runs.reset(new Run[threads]);
+    for (int i = 1; i < threads; i++) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    { std::lock_guard<std::mutex> lock(mutex); stopping = true; }
+    wake.notify_all();
+    for (std::thread& t : workers) t.join();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, int)>& fn) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+    std::unique_lock<std::mutex> owner(busy, std::defer_lock);
+    if (workers.empty() || insidePool || !owner.try_lock()) {
+        bool nested = insidePool; insidePool = true;
+        for (size_t b = 0; b < count; b += grain) fn(b, std::min(count, b + grain), 0);
+        insidePool = nested;
+        return;
+    }
+
+    size_t chunks = (count + grain - 1) / grain, n = (size_t)size();
+    for (size_t i = 0; i < n; i++) {
+        runs[i].next.store(chunks * i / n, std::memory_order_relaxed);
+        runs[i].end = chunks * (i + 1) / n;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn; jobCount = count; jobGrain = grain;
+        active = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    runChunks(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return active == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::runChunks(int id) {
+    insidePool = true;
+    int n = size();
+    for (int k = 0; k < n; k++) {
+        Run& r = runs[(id + k) % n];
+        for (size_t c; (c = r.next.fetch_add(1, std::memory_order_relaxed)) < r.end;) {
+            size_t b = c * jobGrain;
+            (*job)(b, std::min(jobCount, b + jobGrain), id);
+        }
+    }
+    insidePool = false;
+}
+
+void ThreadPool::workerLoop(int id) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        runChunks(id);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0) finished.notify_one();
+    }
+}
+
+ThreadPool& sharedThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,46 @@
+#pragma once
+// Fixed set of worker threads running chunked parallel loops with work stealing.
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // threads = 0 uses one participant per hardware thread; the calling thread is always one of them
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)workers.size() + 1; }
+
+    // Calls fn(begin, end, worker) over [0, count) in chunks of grain items, worker in [0, size()).
+    // Each worker starts on its own contiguous run of chunks and steals from the others' runs once
+    // that is empty. Blocks until every chunk is done. Nested or concurrent calls run inline.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, int)>& fn);
+
+private:
+    struct alignas(64) Run { std::atomic<size_t> next; size_t end; };
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Run[]> runs;
+    std::mutex mutex, busy;
+    std::condition_variable wake, finished;
+    const std::function<void(size_t, size_t, int)>* job;
+    size_t jobCount, jobGrain;
+    uint64_t generation;
+    int active;
+    bool stopping;
+
+    void workerLoop(int id);
+    void runChunks(int id);
+};
+
+// Pool sized to the machine, created on first use
+ThreadPool& sharedThreadPool();
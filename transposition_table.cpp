@@ -0,0 +1,75 @@
+#include "transposition_table.h"
+#include "cube_symmetry.h"
+#include "xoshiro.h"
+
+namespace {
+
+const uint64_t TAG_MASK = ~0xFFull; // the low byte of an entry holds the depth
+
+// One random word per (slot, piece, orientation) and per excluded axis, from a fixed seed so keys
+// are the same in every run
+struct Zobrist {
+    uint64_t corner[8][24], edge[12][24], axis[4];
+    Zobrist() {
+        Xoshiro256 rng(0x7a6f62726973ull);
+        for (auto& slot : corner) for (uint64_t& w : slot) w = rng.next();
+        for (auto& slot : edge) for (uint64_t& w : slot) w = rng.next();
+        for (uint64_t& w : axis) w = rng.next();
+    }
+};
+
+const Zobrist& zobrist() { static const Zobrist z; return z; }
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t bytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Cluster) <= bytes) count *= 2;
+    clusters.reset(new Cluster[count]);
+    mask = count - 1;
+    clear();
+}
+
+uint64_t TranspositionTable::key(const CubeState& s, int axis) {
+    const Zobrist& z = zobrist();
+    CubeState rep;
+    uint64_t k = z.axis[symmetryClass(s, axis, rep) + 1];
+    for (int i = 0; i < 8; i++) k ^= z.corner[i][rep.cp[i] * 3 + rep.co[i]];
+    for (int i = 0; i < 12; i++) k ^= z.edge[i][rep.ep[i] * 2 + rep.eo[i]];
+    return k;
+}
+
+int TranspositionTable::probe(uint64_t key) const {
+    const Cluster& c = clusters[key & mask];
+    for (const std::atomic<uint64_t>& entry : c.entries) {
+        uint64_t e = entry.load(std::memory_order_relaxed);
+        if (e && (e & TAG_MASK) == (key & TAG_MASK)) return (int)(e & 0xFF);
+    }
+    return -1;
+}
+
+void TranspositionTable::store(uint64_t key, int depth) {
+    Cluster& c = clusters[key & mask];
+    uint64_t tag = key & TAG_MASK;
+    int victim = 0, victimDepth = 256;
+    for (int i = 0; i < CLUSTER; i++) {
+        uint64_t e = c.entries[i].load(std::memory_order_relaxed);
+        if (e && (e & TAG_MASK) == tag) {
+            if ((int)(e & 0xFF) < depth) c.entries[i].store(tag | (uint64_t)depth, std::memory_order_relaxed);
+            return;
+        }
+        int d = e ? (int)(e & 0xFF) : 0;
+        if (d < victimDepth) { victim = i; victimDepth = d; }
+    }
+    c.entries[victim].store(tag | (uint64_t)depth, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i <= mask; i++)
+        for (std::atomic<uint64_t>& entry : clusters[i].entries) entry.store(0, std::memory_order_relaxed);
+}
+
+TranspositionTable& sharedTranspositionTable() {
+    static TranspositionTable table;
+    return table;
+}
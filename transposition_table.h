@@ -0,0 +1,39 @@
+#pragma once
+// Fixed-size, lock-free table of search results keyed by symmetry class, shared by solver threads.
+// Each entry is one 64-bit word (key tag | depth) written with a single atomic store, so readers never
+// see a torn entry and no thread ever waits; an entry lost to a racing store only costs a re-search.
+#include "cube_state.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class TranspositionTable {
+public:
+    static const size_t DEFAULT_BYTES = (size_t)64 << 20;
+
+    // Rounded down to a power of two of 64-byte clusters
+    explicit TranspositionTable(size_t bytes = DEFAULT_BYTES);
+
+    // Zobrist key of s's class under the 48 symmetries, for a state searched with turns on axis
+    // excluded (-1 for none); symmetric states with the matching axis share a key
+    static uint64_t key(const CubeState& s, int axis);
+
+    // The depth stored for key, -1 if there is none
+    int probe(uint64_t key) const;
+    // Keeps the deeper of depth (1 .. 255) and what is already stored; otherwise evicts the shallowest
+    // entry of the key's cluster
+    void store(uint64_t key, int depth);
+    void clear();
+    size_t capacity() const { return (mask + 1) * CLUSTER; }
+
+private:
+    static const int CLUSTER = 8; // entries per cache line, everything one probe touches
+    struct alignas(64) Cluster { std::atomic<uint64_t> entries[CLUSTER]; };
+    std::unique_ptr<Cluster[]> clusters;
+    size_t mask;
+};
+
+// The table optimal searches use unless given their own, allocated on first use
+TranspositionTable& sharedTranspositionTable();
@@ -0,0 +1,31 @@
+#pragma once
+// Lock-free handoff of the latest value from one producer thread to one consumer thread. The producer
+// fills back() and publishes it; the consumer takes whatever was published last. Neither side ever
+// waits on the other, and a value the consumer never took is simply overwritten.
+#include <atomic>
+#include <cstdint>
+
+template <typename T> class TripleBuffer {
+public:
+    TripleBuffer() : ready(1), writing(0), reading(2) {}
+
+    // Producer: back() keeps whatever an older value left there, so fill all of it before publish()
+    T& back() { return slots[writing]; }
+    void publish() { writing = ready.exchange((uint8_t)(writing | FRESH), std::memory_order_acq_rel) & INDEX; }
+
+    // Consumer: true if a value was published since the last call; front() is then that value and
+    // stays untouched by the producer until the next acquire()
+    bool acquire() {
+        if (!(ready.load(std::memory_order_relaxed) & FRESH)) return false;
+        reading = ready.exchange(reading, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots[reading]; }
+
+private:
+    static const uint8_t INDEX = 3, FRESH = 4; // ready holds the middle slot's index and whether it is new
+    T slots[3];
+    alignas(64) std::atomic<uint8_t> ready;
+    alignas(64) uint8_t writing; // producer only
+    alignas(64) uint8_t reading; // consumer only
+};
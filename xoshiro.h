@@ -0,0 +1,43 @@
+#pragma once
+// xoshiro256** (Blackman and Vigna): fast 64-bit generator with 256 bits of state and the same
+// sequence on every platform, unlike rand(). Small enough to keep one per thread or per item.
+#include <cstdint>
+
+class Xoshiro256 {
+public:
+    // The state comes from splitmix64 over seed and stream, so each (seed, stream) pair is its own
+    // generator: one per thread or per work item, reproducible whatever the thread count
+    explicit Xoshiro256(uint64_t seed = 0, uint64_t stream = 0) {
+        uint64_t x = seed ^ (stream * 0xd1b54a32d192ed03ull);
+        for (uint64_t& w : s) w = splitmix64(x);
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+        s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+        s[2] ^= t; s[3] = rotl(s[3], 45);
+        return result;
+    }
+    // 0 .. bound-1 for bound below 2^32, by multiply-shift (bias under bound / 2^32)
+    uint32_t below(uint32_t bound) { return (uint32_t)(((next() >> 32) * bound) >> 32); }
+
+    // Advances by 2^128 steps: successive jumps split one seed into non-overlapping streams
+    void jump() {
+        static const uint64_t JUMP[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (uint64_t j : JUMP) for (int b = 0; b < 64; b++) {
+            if (j & (1ull << b)) for (int i = 0; i < 4; i++) t[i] ^= s[i];
+            next();
+        }
+        for (int i = 0; i < 4; i++) s[i] = t[i];
+    }
+
+private:
+    uint64_t s[4];
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    static uint64_t splitmix64(uint64_t& x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull; z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+};